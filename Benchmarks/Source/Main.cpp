@@ -0,0 +1,910 @@
+/*
+  ==============================================================================
+
+    This file contains the basic startup code for a JUCE application.
+
+    Headless benchmark for the distortion DSP and the full processor chain.
+
+        UltimateDistortionBenchmark [--quick] [--filter=<text>] [--json=<file>]
+                                    [--baseline=<file>] [--threshold=<percent>]
+        UltimateDistortionBenchmark --verify [--filter=<text>]
+                                    [--golden=<file>] [--write-golden=<file>]
+        UltimateDistortionBenchmark --instances=<count>
+
+    --quick       fewer block sizes and shorter runs, for a fast sanity check
+    --filter      only runs cases whose name contains the text
+    --json        writes the results as JSON
+    --baseline    compares ns/sample against a previous --json file and exits
+                  with 1 if any case got slower by more than --threshold
+                  (default 10%)
+    --verify      instead of timing anything, checks the vectorised kernels,
+                  approximations and tables against the per-sample reference
+                  functions, and exits with 1 if any is outside its tolerance
+    --golden      also checks the reference outputs against a previous
+                  --write-golden file, to catch changes to the reference itself
+    --instances   loads a session of that many plugins instead: constructs each
+                  processor, restores a saved state, prepares it, runs its first
+                  block and opens and closes its editor, then reports the time of
+                  each step and the peak resident memory per instance
+  
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include <limits>
+#include <map>
+#include "../../Source/PluginProcessor.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <sys/resource.h>
+#endif
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    
+    const juce::StringArray modeNames { "FullWave", "HalfWave", "Hard", "Soft1", "Soft2", "Soft3", "Saturation", "BitCrush" };
+    
+    struct BenchmarkCase
+    {
+        juce::String target;
+        int mode;
+        int blockSize;
+        int numChannels;
+        bool isAutomated;
+        
+        juce::String getName() const
+        {
+            return target + "/" + modeNames[mode] + "/" + juce::String(blockSize) + "/"
+                 + juce::String(numChannels) + "ch/" + (isAutomated ? "automated" : "static");
+        }
+    };
+    
+    struct BenchmarkResult
+    {
+        BenchmarkCase benchmarkCase;
+        double nsPerSample;
+        double cyclesPerSample;
+        double realtimeFactor;
+    };
+    
+    struct Settings
+    {
+        bool isQuick = false;
+        juce::String filter;
+    };
+    
+    //==============================================================================
+    /** Times a monotonic cycle counter where there is one, and otherwise estimates cycles from the reported clock */
+    struct Stopwatch
+    {
+        void start() noexcept
+        {
+            startTicks = juce::Time::getHighResolutionTicks();
+            startCycles = readCycles();
+        }
+        
+        void stop() noexcept
+        {
+            seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            cycles = readCycles() - startCycles;
+            
+            if (cycles <= 0)
+                cycles = seconds * juce::SystemStats::getCpuSpeedInMegahertz() * 1.0e6;
+        }
+        
+        static double readCycles() noexcept
+        {
+           #if JUCE_INTEL
+            return static_cast<double>(__rdtsc());
+           #else
+            return 0.0;
+           #endif
+        }
+        
+        juce::int64 startTicks = 0;
+        double startCycles = 0.0;
+        double seconds = 0.0;
+        double cycles = 0.0;
+    };
+    
+    void fillTestSignal(juce::AudioBuffer<float>& buffer)
+    {
+        juce::Random random(1234);
+        
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            auto* samples = buffer.getWritePointer(channel);
+            
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                const auto phase = juce::MathConstants<double>::twoPi * 110.0 * (i + 17 * channel) / sampleRate;
+                samples[i] = static_cast<float>(0.7 * std::sin(phase) + 0.1 * (random.nextDouble() - 0.5));
+            }
+        }
+    }
+    
+    /** Runs processBlock(blockIndex) for a warm-up and then a few timed passes, and keeps the median pass */
+    template <typename ProcessBlock>
+    BenchmarkResult measure(const BenchmarkCase& benchmarkCase, const Settings& settings, ProcessBlock&& processBlock)
+    {
+        const auto framesPerRun = settings.isQuick ? (1 << 14) : (1 << 17);
+        const auto blocksPerRun = juce::jmax(1, framesPerRun / benchmarkCase.blockSize);
+        const auto numRuns = settings.isQuick ? 3 : 7;
+        
+        // Long enough for the parameter smoothers and the first-use tables to settle
+        const auto warmUpBlocks = juce::jmax(1, static_cast<int>(0.25 * sampleRate) / benchmarkCase.blockSize);
+        
+        int blockIndex = 0;
+        
+        for (int i = 0; i < warmUpBlocks; ++i)
+            processBlock(blockIndex++);
+        
+        std::vector<Stopwatch> runs(static_cast<size_t>(numRuns));
+        
+        for (auto& run : runs)
+        {
+            run.start();
+            
+            for (int i = 0; i < blocksPerRun; ++i)
+                processBlock(blockIndex++);
+            
+            run.stop();
+        }
+        
+        std::sort(runs.begin(), runs.end(), [] (const Stopwatch& a, const Stopwatch& b) { return a.seconds < b.seconds; });
+        const auto& median = runs[runs.size() / 2];
+        
+        const auto frames = static_cast<double>(blocksPerRun) * benchmarkCase.blockSize;
+        const auto samples = frames * benchmarkCase.numChannels;
+        
+        return { benchmarkCase,
+                 median.seconds * 1.0e9 / samples,
+                 median.cycles / samples,
+                 frames / sampleRate / median.seconds };
+    }
+    
+    //==============================================================================
+    template <typename SampleType>
+    BenchmarkResult benchmarkDistortion(const BenchmarkCase& benchmarkCase, const Settings& settings)
+    {
+        using Mode = typename Distortion<SampleType>::Mode;
+        
+        juce::dsp::ProcessSpec spec { sampleRate, static_cast<juce::uint32>(benchmarkCase.blockSize), static_cast<juce::uint32>(benchmarkCase.numChannels) };
+        
+        Distortion<SampleType> distortion;
+        distortion.prepare(spec);
+        distortion.setMode(static_cast<Mode>(benchmarkCase.mode));
+        distortion.setGain(12);
+        distortion.setMix(1);
+        distortion.setOutput(0);
+        
+        juce::AudioBuffer<float> signal(benchmarkCase.numChannels, benchmarkCase.blockSize);
+        fillTestSignal(signal);
+        
+        juce::AudioBuffer<SampleType> input(benchmarkCase.numChannels, benchmarkCase.blockSize);
+        juce::AudioBuffer<SampleType> output(benchmarkCase.numChannels, benchmarkCase.blockSize);
+        
+        for (int channel = 0; channel < input.getNumChannels(); ++channel)
+            for (int i = 0; i < input.getNumSamples(); ++i)
+                input.setSample(channel, i, static_cast<SampleType>(signal.getSample(channel, i)));
+        
+        const juce::dsp::AudioBlock<const SampleType> inputBlock(input);
+        juce::dsp::AudioBlock<SampleType> outputBlock(output);
+        
+        return measure(benchmarkCase, settings, [&] (int blockIndex)
+        {
+            // Automated cases keep every smoother ramping
+            if (benchmarkCase.isAutomated)
+            {
+                const auto isOdd = (blockIndex & 1) != 0;
+                distortion.setGain(isOdd ? 18 : 6);
+                distortion.setMix(isOdd ? SampleType(0.5) : SampleType(1));
+                distortion.setOutput(isOdd ? -6 : 0);
+            }
+            
+            distortion.process(juce::dsp::ProcessContextNonReplacing<SampleType>(inputBlock, outputBlock));
+        });
+    }
+    
+    juce::AudioProcessor::BusesLayout getLayout(int numChannels)
+    {
+        const auto channelSet = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+        
+        // The processor's sidechain has to be listed too, or the layout has the wrong number of buses
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(channelSet);
+        layout.inputBuses.add(juce::AudioChannelSet::disabled());
+        layout.outputBuses.add(channelSet);
+        
+        return layout;
+    }
+    
+    template <typename SampleType>
+    BenchmarkResult benchmarkProcessor(const BenchmarkCase& benchmarkCase, const Settings& settings)
+    {
+        UltimateDistortionAudioProcessor processor;
+        processor.setBusesLayout(getLayout(benchmarkCase.numChannels));
+        processor.setProcessingPrecision(std::is_same<SampleType, double>::value ? juce::AudioProcessor::doublePrecision
+                                                                                 : juce::AudioProcessor::singlePrecision);
+        
+        const auto setParameter = [&processor] (const juce::String& parameterID, float value)
+        {
+            auto* parameter = processor.treeState.getParameter(parameterID);
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        };
+        
+        setParameter("MODE", static_cast<float>(benchmarkCase.mode));
+        setParameter("GAIN", 12.0f);
+        setParameter("MIX", 1.0f);
+        
+        processor.prepareToPlay(sampleRate, benchmarkCase.blockSize);
+        
+        juce::AudioBuffer<float> signal(benchmarkCase.numChannels, benchmarkCase.blockSize);
+        juce::AudioBuffer<SampleType> buffer(benchmarkCase.numChannels, benchmarkCase.blockSize);
+        juce::MidiBuffer midi;
+        fillTestSignal(signal);
+        
+        return measure(benchmarkCase, settings, [&] (int blockIndex)
+        {
+            if (benchmarkCase.isAutomated)
+                setParameter("GAIN", (blockIndex & 1) != 0 ? 18.0f : 6.0f);
+            
+            // The processor works in place, so every block starts again from the same test signal
+            buffer.makeCopyOf(signal, true);
+            processor.processBlock(buffer, midi);
+        });
+    }
+    
+    //==============================================================================
+    juce::Array<BenchmarkCase> createCases(const Settings& settings)
+    {
+        const auto blockSizes = settings.isQuick ? juce::Array<int> { 64, 512, 4096 }
+                                                 : juce::Array<int> { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+        
+        // The plugin itself only accepts the layouts its bus checks allow
+        std::map<int, bool> isProcessorLayoutSupported;
+        
+        {
+            UltimateDistortionAudioProcessor processor;
+            
+            for (auto numChannels : { 1, 2, 6 })
+                isProcessorLayoutSupported[numChannels] = processor.checkBusesLayoutSupported(getLayout(numChannels));
+        }
+        
+        juce::Array<BenchmarkCase> cases;
+        
+        for (const auto& target : { juce::String("distortion-float"), juce::String("distortion-double"), juce::String("processor"), juce::String("processor-double") })
+            for (int mode = 0; mode < modeNames.size(); ++mode)
+                for (auto blockSize : blockSizes)
+                    for (auto numChannels : { 1, 2, 6 })
+                        for (auto isAutomated : { false, true })
+                        {
+                            const BenchmarkCase benchmarkCase { target, mode, blockSize, numChannels, isAutomated };
+                            
+                            if (target.startsWith("processor") && ! isProcessorLayoutSupported[numChannels])
+                                continue;
+                            
+                            if (settings.filter.isEmpty() || benchmarkCase.getName().contains(settings.filter))
+                                cases.add(benchmarkCase);
+                        }
+        
+        return cases;
+    }
+    
+    BenchmarkResult runCase(const BenchmarkCase& benchmarkCase, const Settings& settings)
+    {
+        if (benchmarkCase.target == "distortion-float")
+            return benchmarkDistortion<float>(benchmarkCase, settings);
+        
+        if (benchmarkCase.target == "distortion-double")
+            return benchmarkDistortion<double>(benchmarkCase, settings);
+        
+        if (benchmarkCase.target == "processor-double")
+            return benchmarkProcessor<double>(benchmarkCase, settings);
+        
+        return benchmarkProcessor<float>(benchmarkCase, settings);
+    }
+    
+    juce::var toJSON(const juce::Array<BenchmarkResult>& results)
+    {
+        juce::Array<juce::var> entries;
+        
+        for (const auto& result : results)
+        {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("name", result.benchmarkCase.getName());
+            entry->setProperty("target", result.benchmarkCase.target);
+            entry->setProperty("mode", modeNames[result.benchmarkCase.mode]);
+            entry->setProperty("blockSize", result.benchmarkCase.blockSize);
+            entry->setProperty("channels", result.benchmarkCase.numChannels);
+            entry->setProperty("automated", result.benchmarkCase.isAutomated);
+            entry->setProperty("nsPerSample", result.nsPerSample);
+            entry->setProperty("cyclesPerSample", result.cyclesPerSample);
+            entry->setProperty("realtimeFactor", result.realtimeFactor);
+            entries.add(juce::var(entry));
+        }
+        
+        auto* root = new juce::DynamicObject();
+        root->setProperty("version", 1);
+        root->setProperty("sampleRate", sampleRate);
+        root->setProperty("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty("results", entries);
+        
+        return juce::var(root);
+    }
+    
+    /** Returns the number of cases that are slower than in the baseline by more than the threshold */
+    int compareWithBaseline(const juce::Array<BenchmarkResult>& results, const juce::File& baselineFile, double thresholdPercent)
+    {
+        const auto baseline = juce::JSON::parse(baselineFile);
+        
+        if (! baseline.isObject())
+        {
+            std::cerr << "Couldn't read the baseline " << baselineFile.getFullPathName() << std::endl;
+            return 1;
+        }
+        
+        std::map<juce::String, double> baselineTimes;
+        
+        if (const auto* entries = baseline["results"].getArray())
+            for (const auto& entry : *entries)
+                baselineTimes[entry["name"].toString()] = static_cast<double>(entry["nsPerSample"]);
+        
+        int numRegressions = 0;
+        
+        for (const auto& result : results)
+        {
+            const auto name = result.benchmarkCase.getName();
+            const auto found = baselineTimes.find(name);
+            
+            if (found == baselineTimes.end() || found->second <= 0.0)
+                continue;
+            
+            const auto change = 100.0 * (result.nsPerSample / found->second - 1.0);
+            
+            if (change > thresholdPercent)
+            {
+                std::cout << "REGRESSION " << name << ": " << juce::String(found->second, 3) << " -> "
+                          << juce::String(result.nsPerSample, 3) << " ns/sample (+" << juce::String(change, 1) << "%)" << std::endl;
+                ++numRegressions;
+            }
+        }
+        
+        return numRegressions;
+    }
+    
+    //==============================================================================
+    constexpr int verificationLength = 4096;
+    
+    const juce::StringArray signalNames { "sine", "sine-5k", "sweep", "noise", "impulses", "denormals", "full-scale", "over-scale" };
+    
+    template <typename SampleType>
+    std::vector<SampleType> createVerificationSignal(int signal)
+    {
+        std::vector<SampleType> samples(static_cast<size_t>(verificationLength));
+        juce::Random random(1234);
+        
+        const auto twoPi = juce::MathConstants<double>::twoPi;
+        const auto duration = verificationLength / sampleRate;
+        const auto sweepRatio = std::log(1000.0);
+        
+        for (int i = 0; i < verificationLength; ++i)
+        {
+            const auto time = i / sampleRate;
+            auto value = 0.0;
+            
+            switch (signal)
+            {
+                case 0:  value = 0.7 * std::sin(twoPi * 110.0 * time); break;
+                case 1:  value = 0.9 * std::sin(twoPi * 5000.0 * time); break;
+                case 2:  value = 0.8 * std::sin(twoPi * 20.0 * duration / sweepRatio * (std::exp(time / duration * sweepRatio) - 1.0)); break;
+                case 3:  value = 2.0 * random.nextDouble() - 1.0; break;
+                case 4:  value = i % 512 == 0 ? 1.0 : (i % 512 == 256 ? -1.0 : 0.0); break;
+                case 6:  value = ((i / 32) & 1) != 0 ? 1.0 : -1.0; break;
+                case 7:  value = 4.0 * std::sin(twoPi * 220.0 * time); break;
+                
+                // Denormals of the type under test, which wouldn't survive a trip through double
+                case 5:
+                {
+                    const auto sign = (i & 1) != 0 ? SampleType(-1) : SampleType(1);
+                    samples[static_cast<size_t>(i)] = std::numeric_limits<SampleType>::denorm_min() * static_cast<SampleType>(1 + i % 64) * sign;
+                    continue;
+                }
+                
+                default: break;
+            }
+            
+            samples[static_cast<size_t>(i)] = static_cast<SampleType>(value);
+        }
+        
+        return samples;
+    }
+    
+    struct VerificationPath
+    {
+        const char* name;
+        int precision;
+        int waveshaper;
+    };
+    
+    const VerificationPath verificationPaths[] { { "exact", 0, 0 }, { "high", 1, 0 }, { "medium", 2, 0 }, { "low", 3, 0 },
+                                                 { "linear-table", 0, 1 }, { "cubic-table", 0, 2 } };
+    
+    struct ParameterSet
+    {
+        float gain, mix, output;
+    };
+    
+    const ParameterSet verificationParameters[] { { 12.0f, 1.0f, 0.0f }, { 6.0f, 0.6f, -3.0f } };
+    
+    /** The largest error each path may have in each mode, a few dB or a few ulp above the worst measured across
+        the signals when the suite was written. The exact kernels are held to ulp of the reference, the
+        approximations and tables to dB below full scale. 0 marks a path the mode doesn't have.
+        Soft1 jumps at |x| = 0.33 and 0.67, and a table interpolates across the jump for the few inputs
+        right next to those, so its tables are held to their RMS error instead of the peak. */
+    struct Tolerance
+    {
+        double ulps = 0.0;
+        double decibels = 0.0;
+        bool isRms = false;
+        
+        bool applies() const noexcept { return ulps > 0.0 || decibels < 0.0; }
+    };
+    
+    Tolerance getTolerance(int mode, int path, bool isDouble)
+    {
+        //                                           FullWave  HalfWave  Hard  Soft1  Soft2  Soft3  Saturation  BitCrush
+        static constexpr double floatUlps[]        { 4,        4,        4,    512,   4,     4,     256,        4 };
+        static constexpr double highDecibels[]     { 0,        0,        0,    0,     -128,  -130,  -96,        0 };
+        static constexpr double mediumDecibels[]   { 0,        0,        0,    0,     -98,   -106,  -92,        0 };
+        static constexpr double lowDecibels[]      { 0,        0,        0,    0,     -64,   -60,   -54,        0 };
+        static constexpr double linearDecibels[]   { 0,        0,        0,    -42,   -118,  -116,  -87,        0 };
+        static constexpr double cubicDecibels[]    { 0,        0,        0,    -42,   -128,  -130,  -96,        0 };
+        
+        const auto isSoft1 = mode == 3;
+        
+        switch (path)
+        {
+            case 0:  return { isDouble ? 16.0 : floatUlps[mode], 0.0 };
+            case 1:  return { 0.0, highDecibels[mode] };
+            case 2:  return { 0.0, mediumDecibels[mode] };
+            case 3:  return { 0.0, lowDecibels[mode] };
+            case 4:  return { 0.0, linearDecibels[mode], isSoft1 };
+            case 5:  return { 0.0, cubicDecibels[mode], isSoft1 };
+            default: return {};
+        }
+    }
+    
+    template <typename SampleType>
+    double getUlp(SampleType value)
+    {
+        // Flushing a denormal output to zero is fine, so steps below the smallest normal don't count
+        const auto magnitude = std::abs(value);
+        const auto step = std::nextafter(magnitude, std::numeric_limits<SampleType>::max()) - magnitude;
+        return static_cast<double>(juce::jmax(step, std::numeric_limits<SampleType>::min()));
+    }
+    
+    struct VerificationError
+    {
+        double ulps = 0.0;
+        double absolute = 0.0;
+        double sumOfSquares = 0.0;
+        double numSamples = 0.0;
+        juce::String worstCase;
+        
+        void add(double expected, double actual, double ulp, const juce::String& caseName)
+        {
+            const auto error = std::abs(actual - expected);
+            
+            if (error / ulp > ulps)
+            {
+                ulps = error / ulp;
+                worstCase = caseName;
+            }
+            
+            absolute = juce::jmax(absolute, error);
+            sumOfSquares += error * error;
+            numSamples += 1.0;
+        }
+        
+        double getDecibels(bool isRms) const
+        {
+            const auto error = isRms ? std::sqrt(sumOfSquares / juce::jmax(1.0, numSamples)) : absolute;
+            return juce::Decibels::gainToDecibels(error, -400.0);
+        }
+    };
+    
+    using GoldenOutputs = std::map<juce::String, std::vector<double>>;
+    
+    constexpr int goldenMagic = 0x646c6f47;   // "Gold"
+    
+    GoldenOutputs readGoldenOutputs(const juce::File& file)
+    {
+        GoldenOutputs outputs;
+        juce::FileInputStream stream(file);
+        
+        if (! stream.openedOk() || stream.readInt() != goldenMagic)
+            return outputs;
+        
+        const auto numCases = stream.readInt();
+        
+        for (int i = 0; i < numCases && ! stream.isExhausted(); ++i)
+        {
+            const auto name = stream.readString();
+            auto& samples = outputs[name];
+            samples.resize(static_cast<size_t>(juce::jmax(0, stream.readInt())));
+            
+            for (auto& sample : samples)
+                sample = stream.readDouble();
+        }
+        
+        return outputs;
+    }
+    
+    void writeGoldenOutputs(const GoldenOutputs& outputs, const juce::File& file)
+    {
+        file.deleteFile();
+        juce::FileOutputStream stream(file);
+        
+        stream.writeInt(goldenMagic);
+        stream.writeInt(static_cast<int>(outputs.size()));
+        
+        for (const auto& [name, samples] : outputs)
+        {
+            stream.writeString(name);
+            stream.writeInt(static_cast<int>(samples.size()));
+            
+            for (auto sample : samples)
+                stream.writeDouble(sample);
+        }
+    }
+    
+    template <typename SampleType>
+    void prepareForVerification(Distortion<SampleType>& distortion, int mode, const VerificationPath& path,
+                                const ParameterSet& parameters, int numChannels)
+    {
+        using ChainDistortion = Distortion<SampleType>;
+        
+        juce::dsp::ProcessSpec spec { sampleRate, static_cast<juce::uint32>(verificationLength), static_cast<juce::uint32>(numChannels) };
+        distortion.prepare(spec);
+        distortion.setMode(static_cast<typename ChainDistortion::Mode>(mode));
+        distortion.setPrecision(static_cast<typename ChainDistortion::Precision>(path.precision));
+        distortion.setWaveshaper(static_cast<typename ChainDistortion::Mode>(mode), static_cast<typename ChainDistortion::Waveshaper>(path.waveshaper));
+        distortion.reset();
+        distortion.setGain(parameters.gain);
+        distortion.setMix(parameters.mix);
+        distortion.setOutput(parameters.output);
+        
+        // Lands every smoother on its target, so both sides see the same constant parameters from the first sample
+        distortion.setSampleRate(sampleRate);
+    }
+    
+    /** Runs every mode and path of one precision and prints a line per pair. Returns the number outside their tolerance. */
+    template <typename SampleType>
+    int verifyPrecision(const juce::String& filter, const GoldenOutputs& golden, GoldenOutputs& outputsToWrite)
+    {
+        const auto isDouble = std::is_same<SampleType, double>::value;
+        const juce::String precisionName = isDouble ? "double" : "float";
+        int numFailures = 0;
+        
+        for (int mode = 0; mode < modeNames.size(); ++mode)
+        {
+            // The per-sample functions against the stored golden outputs, and then each path against the per-sample functions
+            VerificationError referenceError;
+            std::vector<VerificationError> pathErrors(std::size(verificationPaths));
+            
+            for (int signal = 0; signal < signalNames.size(); ++signal)
+            {
+                const auto input = createVerificationSignal<SampleType>(signal);
+                
+                for (size_t set = 0; set < std::size(verificationParameters); ++set)
+                {
+                    const auto& parameters = verificationParameters[set];
+                    const auto caseName = precisionName + "/" + modeNames[mode] + "/" + signalNames[signal] + "/" + juce::String(static_cast<int>(set));
+                    
+                    // The second channel gets the inverted signal, which the asymmetric modes treat differently
+                    Distortion<SampleType> reference;
+                    prepareForVerification(reference, mode, verificationPaths[0], parameters, 1);
+                    std::array<std::vector<SampleType>, 2> expected;
+                    
+                    for (size_t channel = 0; channel < expected.size(); ++channel)
+                        for (auto sample : input)
+                            expected[channel].push_back(reference.processSample(channel == 0 ? sample : -sample));
+                    
+                    const auto found = golden.find(caseName);
+                    
+                    if (found != golden.end() && found->second.size() == expected[0].size())
+                        for (size_t i = 0; i < expected[0].size(); ++i)
+                            referenceError.add(found->second[i], expected[0][i], getUlp(static_cast<SampleType>(found->second[i])), caseName);
+                    
+                    outputsToWrite[caseName] = std::vector<double>(expected[0].begin(), expected[0].end());
+                    
+                    for (size_t path = 0; path < std::size(verificationPaths); ++path)
+                    {
+                        if (! getTolerance(mode, static_cast<int>(path), isDouble).applies())
+                            continue;
+                        
+                        // An odd block size leaves a partial register at the end of every block
+                        for (auto blockSize : { 61, verificationLength })
+                        {
+                            Distortion<SampleType> distortion;
+                            prepareForVerification(distortion, mode, verificationPaths[path], parameters, 2);
+                            
+                            juce::AudioBuffer<SampleType> buffer(2, verificationLength);
+                            
+                            for (int i = 0; i < verificationLength; ++i)
+                            {
+                                buffer.setSample(0, i, input[static_cast<size_t>(i)]);
+                                buffer.setSample(1, i, -input[static_cast<size_t>(i)]);
+                            }
+                            
+                            for (int start = 0; start < verificationLength; start += blockSize)
+                            {
+                                const auto numSamples = juce::jmin(blockSize, verificationLength - start);
+                                auto block = juce::dsp::AudioBlock<SampleType>(buffer).getSubBlock(static_cast<size_t>(start), static_cast<size_t>(numSamples));
+                                distortion.process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+                            }
+                            
+                            for (int channel = 0; channel < 2; ++channel)
+                                for (int i = 0; i < verificationLength; ++i)
+                                {
+                                    const auto expectedSample = expected[static_cast<size_t>(channel)][static_cast<size_t>(i)];
+                                    pathErrors[path].add(expectedSample, buffer.getSample(channel, i), getUlp(expectedSample), caseName + "/" + juce::String(blockSize));
+                                }
+                        }
+                    }
+                }
+            }
+            
+            auto report = [&] (const juce::String& name, const VerificationError& error, const Tolerance& tolerance)
+            {
+                if (filter.isNotEmpty() && ! name.contains(filter))
+                    return;
+                
+                const auto isExact = tolerance.ulps > 0.0;
+                const auto passed = isExact ? error.ulps <= tolerance.ulps : error.getDecibels(tolerance.isRms) <= tolerance.decibels;
+                
+                std::cout << name.paddedRight(' ', 36)
+                          << juce::String(error.ulps, 1).paddedLeft(' ', 14) << " ulp"
+                          << juce::String(error.getDecibels(false), 1).paddedLeft(' ', 10) << " dB peak"
+                          << juce::String(error.getDecibels(true), 1).paddedLeft(' ', 10) << " dB rms"
+                          << "   limit " << (isExact ? juce::String(tolerance.ulps, 0) + " ulp"
+                                                     : juce::String(tolerance.decibels, 0) + (tolerance.isRms ? " dB rms" : " dB peak"))
+                          << (passed ? juce::String() : "   FAIL at " + error.worstCase) << std::endl;
+                
+                numFailures += passed ? 0 : 1;
+            };
+            
+            if (! golden.empty())
+                report(precisionName + "/" + modeNames[mode] + "/golden", referenceError, getTolerance(mode, 0, isDouble));
+            
+            for (size_t path = 0; path < std::size(verificationPaths); ++path)
+            {
+                const auto tolerance = getTolerance(mode, static_cast<int>(path), isDouble);
+                
+                if (tolerance.applies())
+                    report(precisionName + "/" + modeNames[mode] + "/" + verificationPaths[path].name, pathErrors[path], tolerance);
+            }
+        }
+        
+        return numFailures;
+    }
+    
+    int runVerification(const juce::ArgumentList& arguments)
+    {
+        const auto filter = arguments.getValueForOption("--filter");
+        const auto goldenPath = arguments.getValueForOption("--golden");
+        const auto writePath = arguments.getValueForOption("--write-golden");
+        
+        GoldenOutputs golden, outputsToWrite;
+        
+        if (goldenPath.isNotEmpty())
+        {
+            golden = readGoldenOutputs(juce::File::getCurrentWorkingDirectory().getChildFile(goldenPath));
+            
+            if (golden.empty())
+            {
+                std::cerr << "Couldn't read the golden outputs " << goldenPath << std::endl;
+                return 1;
+            }
+        }
+        
+        std::cout << "path                                  worst error (max over signals)" << std::endl;
+        
+        const auto numFailures = verifyPrecision<float>(filter, golden, outputsToWrite)
+                               + verifyPrecision<double>(filter, golden, outputsToWrite);
+        
+        if (writePath.isNotEmpty())
+            writeGoldenOutputs(outputsToWrite, juce::File::getCurrentWorkingDirectory().getChildFile(writePath));
+        
+        if (numFailures > 0)
+        {
+            std::cout << numFailures << " path(s) outside their tolerance" << std::endl;
+            return 1;
+        }
+        
+        return 0;
+    }
+    
+    //==============================================================================
+    /** The peak resident memory of the process so far, in bytes, or 0 where it can't be read */
+    juce::int64 getPeakResidentBytes()
+    {
+       #if JUCE_LINUX || JUCE_MAC
+        rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+        
+        // Linux reports kilobytes and macOS bytes
+        #if JUCE_MAC
+        return static_cast<juce::int64>(usage.ru_maxrss);
+        #else
+        return static_cast<juce::int64>(usage.ru_maxrss) * 1024;
+        #endif
+       #else
+        return 0;
+       #endif
+    }
+    
+    /** Opens a session the way a host does: every instance is created, restored, prepared and runs
+        a block, and its editor is opened and closed without a window. All of them stay loaded, so the
+        growth of the peak memory over the session is what the instances cost together. */
+    int runSessionLoad(const juce::ArgumentList& arguments)
+    {
+        const auto numInstances = juce::jmax(1, arguments.getValueForOption("--instances").getIntValue());
+        constexpr int blockSize = 512;
+        
+        enum Step { kConstruct, kRestore, kPrepare, kFirstBlock, kOpenEditor, kCloseEditor, kNumSteps };
+        const char* stepNames[] { "construct", "setStateInformation", "prepareToPlay", "first block", "open editor", "close editor" };
+        std::array<double, kNumSteps> seconds {};
+        
+        auto time = [&seconds] (Step step, auto&& function)
+        {
+            Stopwatch stopwatch;
+            stopwatch.start();
+            function();
+            stopwatch.stop();
+            seconds[static_cast<size_t>(step)] += stopwatch.seconds;
+        };
+        
+        const auto startBytes = getPeakResidentBytes();
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        
+        // Every instance restores the same state: three bands and 8x linear phase oversampling,
+        // the most expensive filters to design
+        juce::MemoryBlock state;
+        
+        {
+            UltimateDistortionAudioProcessor processor;
+            
+            for (const auto& setting : { std::make_pair("MODE", 6.0f), std::make_pair("GAIN", 12.0f), std::make_pair("MIX", 1.0f),
+                                         std::make_pair("BANDS", 2.0f), std::make_pair("OVERSAMPLING", 3.0f), std::make_pair("OSFILTER", 1.0f) })
+            {
+                auto* parameter = processor.treeState.getParameter(setting.first);
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(setting.second));
+            }
+            
+            processor.getStateInformation(state);
+        }
+        
+        juce::AudioBuffer<float> signal(2, blockSize), buffer(2, blockSize);
+        juce::MidiBuffer midi;
+        fillTestSignal(signal);
+        
+        juce::OwnedArray<UltimateDistortionAudioProcessor> session;
+        
+        for (int i = 0; i < numInstances; ++i)
+        {
+            UltimateDistortionAudioProcessor* processor = nullptr;
+            
+            time(kConstruct, [&]
+            {
+                processor = session.add(std::make_unique<UltimateDistortionAudioProcessor>());
+                processor->setBusesLayout(getLayout(2));
+            });
+            
+            time(kRestore, [&] { processor->setStateInformation(state.getData(), static_cast<int>(state.getSize())); });
+            time(kPrepare, [&] { processor->prepareToPlay(sampleRate, blockSize); });
+            
+            time(kFirstBlock, [&]
+            {
+                buffer.makeCopyOf(signal, true);
+                processor->processBlock(buffer, midi);
+            });
+            
+            std::unique_ptr<juce::AudioProcessorEditor> editor;
+            time(kOpenEditor, [&] { editor.reset(processor->createEditorIfNeeded()); });
+            time(kCloseEditor, [&] { editor.reset(); });
+        }
+        
+        const auto totalSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        const auto peakBytes = getPeakResidentBytes();
+        
+        std::cout << numInstances << " instances, " << blockSize << " samples per block" << std::endl;
+        std::cout << "step                      total ms  ms/instance" << std::endl;
+        
+        for (size_t step = 0; step < seconds.size(); ++step)
+        {
+            std::cout << juce::String(stepNames[step]).paddedRight(' ', 22)
+                      << juce::String(seconds[step] * 1.0e3, 2).paddedLeft(' ', 12)
+                      << juce::String(seconds[step] * 1.0e3 / numInstances, 3).paddedLeft(' ', 13) << std::endl;
+        }
+        
+        std::cout << juce::String("session").paddedRight(' ', 22)
+                  << juce::String(totalSeconds * 1.0e3, 2).paddedLeft(' ', 12)
+                  << juce::String(totalSeconds * 1.0e3 / numInstances, 3).paddedLeft(' ', 13) << std::endl;
+        
+        if (peakBytes > 0)
+        {
+            std::cout << "peak RSS " << juce::String(peakBytes / 1048576.0, 1) << " MB, "
+                      << juce::String((peakBytes - startBytes) / 1024.0 / numInstances, 1) << " KB per instance" << std::endl;
+        }
+        
+        return 0;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // The processor's parameter state needs a message manager, even without any windows
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList arguments(argc, argv);
+    
+    if (arguments.containsOption("--verify"))
+        return runVerification(arguments);
+    
+    if (arguments.containsOption("--instances"))
+        return runSessionLoad(arguments);
+    
+    Settings settings;
+    settings.isQuick = arguments.containsOption("--quick");
+    settings.filter = arguments.getValueForOption("--filter");
+    
+    const auto cases = createCases(settings);
+    juce::Array<BenchmarkResult> results;
+    
+    std::cout << juce::SystemStats::getCpuModel() << ", " << cases.size() << " cases" << std::endl;
+    std::cout << "case                                                ns/sample  cycles/sample  realtime" << std::endl;
+    
+    for (const auto& benchmarkCase : cases)
+    {
+        const auto result = runCase(benchmarkCase, settings);
+        results.add(result);
+        
+        std::cout << benchmarkCase.getName().paddedRight(' ', 50)
+                  << juce::String(result.nsPerSample, 3).paddedLeft(' ', 11)
+                  << juce::String(result.cyclesPerSample, 2).paddedLeft(' ', 15)
+                  << juce::String(result.realtimeFactor, 1).paddedLeft(' ', 10) << "x" << std::endl;
+    }
+    
+    const auto jsonPath = arguments.getValueForOption("--json");
+    
+    if (jsonPath.isNotEmpty())
+        juce::File::getCurrentWorkingDirectory().getChildFile(jsonPath).replaceWithText(juce::JSON::toString(toJSON(results)));
+    
+    const auto baselinePath = arguments.getValueForOption("--baseline");
+    
+    if (baselinePath.isNotEmpty())
+    {
+        const auto threshold = arguments.containsOption("--threshold") ? arguments.getValueForOption("--threshold").getDoubleValue() : 10.0;
+        const auto numRegressions = compareWithBaseline(results, juce::File::getCurrentWorkingDirectory().getChildFile(baselinePath), threshold);
+        
+        if (numRegressions > 0)
+        {
+            std::cout << numRegressions << " case(s) regressed by more than " << threshold << "%" << std::endl;
+            return 1;
+        }
+    }
+    
+    return 0;
+}
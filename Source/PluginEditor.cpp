@@ -16,14 +16,14 @@ UltimateDistortionAudioProcessorEditor::UltimateDistortionAudioProcessorEditor (
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
     setResizable(true, true);
-    setSize (500, 250);
-    setResizeLimits(500, 250, 700, 350);
-    getConstrainer()->setFixedAspectRatio(2.0);
+    setSize (600, 400);
+    setResizeLimits(600, 400, 840, 560);
+    getConstrainer()->setFixedAspectRatio(1.5);
     
     addAndMakeVisible(modeBar);
     modeBar.setColour(juce::Slider::ColourIds::rotarySliderFillColourId, juce::Colours::whitesmoke.withAlpha(0.5f));
     modeBar.setVisible(false);
-        
+    
     addAndMakeVisible(modeButton1);
     modeButton1.setClickingTogglesState(true);
     modeButton1.onClick = [this] { selectMode(&modeButton1, 0.0); };
@@ -132,10 +132,76 @@ UltimateDistortionAudioProcessorEditor::UltimateDistortionAudioProcessorEditor (
     outputLabel.setJustificationType(juce::Justification::centred);
     outputLabel.attachToComponent(&outputKnob, false);
     
+    addAndMakeVisible(inputMeter);
+    addAndMakeVisible(outputMeter);
+    addAndMakeVisible(transferCurve);
+    addAndMakeVisible(spectrumView);
+    
+    addAndMakeVisible(cabinetButton);
+    cabinetButton.setButtonText("Load IR");
+    cabinetButton.onClick = [this] { chooseCabinetFile(); };
+    
+    // The audio thread only measures levels and copies samples while there is an editor to show them
+    audioProcessor.setMeteringEnabled(true);
+    audioProcessor.setAnalyzerEnabled(true);
+    startTimerHz(30);
 }
 
 UltimateDistortionAudioProcessorEditor::~UltimateDistortionAudioProcessorEditor()
 {
+    stopTimer();
+    audioProcessor.setMeteringEnabled(false);
+    audioProcessor.setAnalyzerEnabled(false);
+}
+
+void UltimateDistortionAudioProcessorEditor::timerCallback()
+{
+    // Several blocks arrive per tick; show the loudest peak and the latest RMS of them
+    LevelFrame frame, levels;
+    auto hasLevels = false;
+    
+    while (audioProcessor.getLevelFifo().pop(frame))
+    {
+        for (size_t channel = 0; channel < 2; ++channel)
+        {
+            frame.inputPeak[channel] = juce::jmax(frame.inputPeak[channel], levels.inputPeak[channel]);
+            frame.outputPeak[channel] = juce::jmax(frame.outputPeak[channel], levels.outputPeak[channel]);
+        }
+        
+        levels = frame;
+        hasLevels = true;
+    }
+    
+    // Without new frames the meters still fall back, e.g. once processing has gone idle
+    inputMeter.setLevels(levels.inputPeak, levels.inputRms);
+    outputMeter.setLevels(levels.outputPeak, levels.outputRms);
+    
+    const auto mode = static_cast<int>(audioProcessor.treeState.getRawParameterValue("MODE")->load());
+    const auto gain = audioProcessor.treeState.getRawParameterValue("GAIN")->load();
+    const auto bits = audioProcessor.treeState.getRawParameterValue("BITS")->load();
+    transferCurve.setCurve(UltimateDistortionAudioProcessor::getMode<float>(mode), gain, bits);
+    
+    if (hasLevels)
+        transferCurve.setInputLevel(juce::jmax(levels.inputPeak[0], levels.inputPeak[1]));
+    
+    spectrumView.update(audioProcessor.getSampleRate());
+}
+
+void UltimateDistortionAudioProcessorEditor::chooseCabinetFile()
+{
+    cabinetChooser = std::make_unique<juce::FileChooser>("Load an impulse response", audioProcessor.getCabinetFile(), "*.wav;*.aif;*.aiff");
+    
+    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+    
+    cabinetChooser->launchAsync(flags, [this] (const juce::FileChooser& chooser)
+    {
+        auto file = chooser.getResult();
+        
+        if (file == juce::File())
+            return;
+        
+        audioProcessor.loadCabinetFile(file);
+    });
 }
 
 //==============================================================================
@@ -160,9 +226,23 @@ void UltimateDistortionAudioProcessorEditor::resized()
     area.removeFromLeft(sideWidth);
     area.removeFromRight(sideWidth);
     
+    auto spectrumArea = area.removeFromBottom(getHeight() / 4);
+    spectrumView.setBounds(spectrumArea.reduced(0, getHeight() / 40));
+    
+    // Meters either side of the transfer curve, on the right of the controls
+    auto displayArea = area.removeFromRight(getWidth() / 4).reduced(0, getHeight() / 10);
+    area.removeFromRight(sideWidth);
+    
+    auto meterWidth = displayArea.getWidth() / 10;
+    inputMeter.setBounds(displayArea.removeFromLeft(meterWidth));
+    outputMeter.setBounds(displayArea.removeFromRight(meterWidth));
+    displayArea.reduce(meterWidth / 2, 0);
+    transferCurve.setBounds(displayArea.withSizeKeepingCentre(displayArea.getWidth(), displayArea.getWidth()));
+    
     auto headerFooterHeight = getHeight() / 10;
     modeLabel.setBounds(area.removeFromTop(headerFooterHeight));
-    area.removeFromBottom(headerFooterHeight);
+    auto footerArea = area.removeFromBottom(headerFooterHeight);
+    cabinetButton.setBounds(footerArea.removeFromRight(footerArea.getWidth() / 4).reduced(0, headerFooterHeight / 5));
     
     auto buttonHeight = getHeight() / 8;
     auto modeBarArea = area.removeFromTop(buttonHeight);
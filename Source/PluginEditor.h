@@ -10,28 +10,31 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "meters.h"
 
 //==============================================================================
 /**
 */
-class UltimateDistortionAudioProcessorEditor  : public juce::AudioProcessorEditor
+class UltimateDistortionAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                                private juce::Timer
 {
 public:
     UltimateDistortionAudioProcessorEditor (UltimateDistortionAudioProcessor&);
     ~UltimateDistortionAudioProcessorEditor() override;
-
+    
     //==============================================================================
     void paint (juce::Graphics&) override;
     void resized() override;
 
 private:
+    void timerCallback() override;
+    void chooseCabinetFile();
+    
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     UltimateDistortionAudioProcessor& audioProcessor;
     
     //==============================================================================
-    juce::LookAndFeel_V4 knobLookAndFeel;
-    
     juce::TextButton modeBar;
     juce::TextButton modeButton1;
     juce::TextButton modeButton2;
@@ -51,11 +54,19 @@ private:
     juce::Label toneLabel;
     juce::Label outputLabel;
     
-    juce::Array<juce::TextButton> buttons;
+    LevelMeter inputMeter;
+    LevelMeter outputMeter;
+    TransferCurve transferCurve;
+    SpectrumView spectrumView { audioProcessor.getAnalyzerFifo() };
     
+    juce::TextButton cabinetButton;
+    std::unique_ptr<juce::FileChooser> cabinetChooser;
+    
+    juce::Array<juce::TextButton> buttons;
+
 //    juce::AudioProcessorValueTreeState::ButtonAttachment modeAttachment;
     juce::AudioProcessorValueTreeState::SliderAttachment gainAttachment, mixAttachment, toneAttachment, outputAttachment;
-
+    
     void selectMode(juce::TextButton* button, float modeIndex)
     {
         
@@ -16,28 +16,43 @@ UltimateDistortionAudioProcessor::UltimateDistortionAudioProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        ), treeState(*this, nullptr, "PARAMETERS", createParameterLayout())
 #endif
 {
-    treeState.addParameterListener("MODE", this);
-    treeState.addParameterListener("GAIN", this);
-    treeState.addParameterListener("MIX", this);
-    treeState.addParameterListener("TONE", this);
-    treeState.addParameterListener("OUTPUT", this);
+    for (size_t i = 0; i < parameterIDs.size(); ++i)
+    {
+        treeState.addParameterListener(parameterIDs[i], this);
+        parameters.publish(i, treeState.getRawParameterValue(parameterIDs[i])->load());
+        parameterObjects.add(treeState.getParameter(parameterIDs[i]));
+    }
+    
+    presets.build(parameterObjects);
 }
 
 UltimateDistortionAudioProcessor::~UltimateDistortionAudioProcessor()
 {
-    treeState.removeParameterListener("MODE", this);
-    treeState.removeParameterListener("GAIN", this);
-    treeState.removeParameterListener("MIX", this);
-    treeState.removeParameterListener("TONE", this);
-    treeState.removeParameterListener("OUTPUT", this);
+    cancelPendingUpdate();
+    
+    for (auto* parameterID : parameterIDs)
+        treeState.removeParameterListener(parameterID, this);
 }
 
+const std::array<const char*, UltimateDistortionAudioProcessor::kNumParameters> UltimateDistortionAudioProcessor::parameterIDs
+{
+    "MODE", "GAIN", "MIX", "TONE", "OUTPUT", "OVERSAMPLING", "OSFILTER", "ADAA", "PRECISION",
+    "BANDS", "XOVER1", "XOVER2", "XOVER3",
+    "MODE2", "GAIN2", "MIX2", "MODE3", "GAIN3", "MIX3", "MODE4", "GAIN4", "MIX4",
+    "BITS", "RATE", "DITHER",
+    "ENVDEPTH", "ATTACK", "RELEASE", "ENVSOURCE",
+    "STEREO", "SIDEGAIN", "SIDEMIX",
+    "MODEB", "GAINB", "MIXB", "TONEB", "OUTPUTB", "MORPH",
+    "CABINET", "CABMIX"
+};
+
 juce::AudioProcessorValueTreeState::ParameterLayout UltimateDistortionAudioProcessor::createParameterLayout()
 {
     std::vector<std::unique_ptr<juce::RangedAudioParameter>> params;
@@ -49,71 +64,372 @@ juce::AudioProcessorValueTreeState::ParameterLayout UltimateDistortionAudioProce
     auto pMix = std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"MIX", 1}), "Mix", 0.0f, 1.0f, 0.0f);
     auto pTone = std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"TONE", 1}), "Tone", 0.0f, 20000.0f, 20000.0f);
     auto pOutput = std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"OUTPUT", 1}), "Output", -24.0f, 24.0f, 0.0f);
+    auto pOversampling = std::make_unique<juce::AudioParameterChoice>(juce::ParameterID({"OVERSAMPLING", 1}), "Oversampling", juce::StringArray {"1x", "2x", "4x", "8x", "16x"}, 0);
+    auto pOversamplingFilter = std::make_unique<juce::AudioParameterChoice>(juce::ParameterID({"OSFILTER", 1}), "Oversampling Filter", juce::StringArray {"Polyphase IIR", "Linear Phase FIR"}, 0);
+    auto pAntialiasing = std::make_unique<juce::AudioParameterChoice>(juce::ParameterID({"ADAA", 1}), "Antialiasing", juce::StringArray {"Off", "ADAA 1st Order", "ADAA 2nd Order"}, 0);
+    auto pPrecision = std::make_unique<juce::AudioParameterChoice>(juce::ParameterID({"PRECISION", 1}), "Realtime Precision", juce::StringArray {"Exact", "High", "Medium", "Low"}, 1);
+    auto pBands = std::make_unique<juce::AudioParameterChoice>(juce::ParameterID({"BANDS", 1}), "Bands", juce::StringArray {"1", "2", "3", "4"}, 0);
+    
+    juce::NormalisableRange<float> crossoverRange (20.0f, 20000.0f, 1.0f, 0.25f);
+    auto pCrossover1 = std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"XOVER1", 1}), "Crossover 1", crossoverRange, 200.0f);
+    auto pCrossover2 = std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"XOVER2", 1}), "Crossover 2", crossoverRange, 1000.0f);
+    auto pCrossover3 = std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"XOVER3", 1}), "Crossover 3", crossoverRange, 5000.0f);
     params.push_back(std::move(pMode));
     params.push_back(std::move(pGain));
     params.push_back(std::move(pMix));
     params.push_back(std::move(pTone));
     params.push_back(std::move(pOutput));
+    params.push_back(std::move(pOversampling));
+    params.push_back(std::move(pOversamplingFilter));
+    params.push_back(std::move(pAntialiasing));
+    params.push_back(std::move(pPrecision));
+    params.push_back(std::move(pBands));
+    params.push_back(std::move(pCrossover1));
+    params.push_back(std::move(pCrossover2));
+    params.push_back(std::move(pCrossover3));
+    
+    // Bands 2 to 4 get the same controls as the main MODE, GAIN and MIX
+    for (int band = 2; band <= MultibandDistortion<float>::maxBands; ++band)
+    {
+        auto suffix = juce::String(band);
+        params.push_back(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID({"MODE" + suffix, 1}), "Mode " + suffix, modes, 0));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"GAIN" + suffix, 1}), "Gain " + suffix, 0.0f, 24.0f, 0.0f));
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"MIX" + suffix, 1}), "Mix " + suffix, 0.0f, 1.0f, 0.0f));
+    }
+    
+    // The Bit mode's converter, shared by every band that uses it. RATE at its maximum holds nothing.
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"BITS", 1}), "Bit Depth", juce::NormalisableRange<float> (1.0f, 16.0f, 0.01f), 8.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"RATE", 1}), "Sample Rate", juce::NormalisableRange<float> (500.0f, maxCrushRate, 1.0f, 0.3f), maxCrushRate));
+    params.push_back(std::make_unique<juce::AudioParameterBool>(juce::ParameterID({"DITHER", 1}), "Dither", false));
+    
+    // Dynamic drive: how far the envelope of the input, or of the sidechain, pushes every band's GAIN
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"ENVDEPTH", 1}), "Envelope Depth", -24.0f, 24.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"ATTACK", 1}), "Attack", juce::NormalisableRange<float> (0.1f, 100.0f, 0.01f, 0.4f), 10.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"RELEASE", 1}), "Release", juce::NormalisableRange<float> (5.0f, 1000.0f, 0.1f, 0.4f), 150.0f));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID({"ENVSOURCE", 1}), "Envelope Source", juce::StringArray {"Input", "Sidechain"}, 0));
+    
+    // In Mid/Side every band shapes its mid with its own GAIN and MIX and its side with these
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID({"STEREO", 1}), "Stereo", juce::StringArray {"L/R", "Mid/Side", "Linked"}, 0));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"SIDEGAIN", 1}), "Side Gain", 0.0f, 24.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"SIDEMIX", 1}), "Side Mix", 0.0f, 1.0f, 0.0f));
+    
+    // A second snapshot of MODE, GAIN, MIX, TONE and OUTPUT, and how far MORPH moves from the first to it
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID({"MODEB", 1}), "Mode B", modes, 0));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"GAINB", 1}), "Gain B", 0.0f, 24.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"MIXB", 1}), "Mix B", 0.0f, 1.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"TONEB", 1}), "Tone B", 0.0f, 20000.0f, 20000.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"OUTPUTB", 1}), "Output B", -24.0f, 24.0f, 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"MORPH", 1}), "Morph", 0.0f, 1.0f, 0.0f));
+    
+    // The cabinet after the distortion, in the order of Cabinet::Model. Custom plays the loaded file.
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID({"CABINET", 1}), "Cabinet", juce::StringArray {"Off", "4x12 Closed", "2x12 Open", "1x12 Combo", "8x10 Bass", "Custom"}, 0));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID({"CABMIX", 1}), "Cabinet Mix", 0.0f, 1.0f, 1.0f));
     return { params.begin(), params.end () };
 }
 
 void UltimateDistortionAudioProcessor::parameterChanged (const juce::String& parameterID, float newValue)
 {
-    updateParameters();
+    // This may run on any thread, so it only publishes; the audio thread applies it at its next block
+    for (size_t i = 0; i < parameterIDs.size(); ++i)
+    {
+        if (parameterID == parameterIDs[i])
+        {
+            parameters.publish(i, newValue);
+            
+            // The newly selected oversampler may not exist yet and the cabinet's response has to be
+            // loaded, neither of which the audio thread can do
+            if (i == kOversamplingParameter || i == kOversamplingFilterParameter || i == kCabinetParameter)
+                triggerAsyncUpdate();
+            
+            return;
+        }
+    }
+}
+
+void UltimateDistortionAudioProcessor::handleAsyncUpdate()
+{
+    // First, so that the oversampler and cabinet below are the ones the program asks for
+    const auto program = pendingProgram.exchange(-1);
+    
+    if (program >= 0)
+        presets.apply(program);
+    
+    updateLatency();
+    
+    // Only the prepared chain builds anything
+    const auto oversampler = getRequestedOversampler();
+    buildOversampler(floatChain, oversampler);
+    buildOversampler(doubleChain, oversampler);
+    
+    updateCabinet();
+}
+
+void UltimateDistortionAudioProcessor::updateCabinet()
+{
+    const juce::ScopedLock scope (cabinetLock);
+    
+    const auto model = static_cast<Cabinet::Model>(static_cast<int>(parameters.get(kCabinetParameter)));
+    
+    // Switching the stage off keeps the response loaded, so switching back doesn't reload it
+    if (model == Cabinet::Model::kOff || model == loadedModel)
+        return;
+    
+    if (model == Cabinet::Model::kCustom)
+    {
+        if (! cabinetFile.existsAsFile())
+            return;
+        
+        cabinet.loadFile(cabinetFile);
+    }
+    else
+    {
+        cabinet.loadModel(model);
+    }
+    
+    loadedModel = model;
+}
+
+void UltimateDistortionAudioProcessor::loadCabinetFile(const juce::File& file)
+{
+    {
+        const juce::ScopedLock scope (cabinetLock);
+        cabinetFile = file;
+        loadedModel = Cabinet::Model::kOff;
+    }
+    
+    // Selecting Custom publishes it to the snapshot before the response is loaded below
+    auto* parameter = treeState.getParameter(parameterIDs[kCabinetParameter]);
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(static_cast<float>(Cabinet::Model::kCustom)));
+    
+    updateCabinet();
+}
+
+juce::File UltimateDistortionAudioProcessor::getCabinetFile() const
+{
+    const juce::ScopedLock scope (cabinetLock);
+    return cabinetFile;
+}
+
+UltimateDistortionAudioProcessor::ParameterIndex UltimateDistortionAudioProcessor::getBandParameter(int band, BandParameter parameter) noexcept
+{
+    if (band == 0)
+    {
+        constexpr ParameterIndex firstBand[] { kModeParameter, kGainParameter, kMixParameter };
+        return firstBand[parameter];
+    }
+    
+    return static_cast<ParameterIndex>(kBand2ModeParameter + (band - 1) * kNumBandParameters + parameter);
 }
 
-void UltimateDistortionAudioProcessor::updateParameters()
+template <typename SampleType>
+typename Distortion<SampleType>::Mode UltimateDistortionAudioProcessor::getMode(int choice) noexcept
 {
-    auto model = static_cast<int>(treeState.getRawParameterValue("MODE")->load());
-    switch(model)
+    using Mode = typename Distortion<SampleType>::Mode;
+    
+    switch(choice)
     {
         case 0:
-        {
-            distortion.setMode(Distortion<float>::Mode::kFullWave);
-            break;
-        }
+            return Mode::kFullWave;
         case 1:
-        {
-            distortion.setMode(Distortion<float>::Mode::kHalfWave);
-            break;
-        }
+            return Mode::kHalfWave;
         case 2:
-        {
-            distortion.setMode(Distortion<float>::Mode::kHard);
-            break;
-        }
+            return Mode::kHard;
         case 3:
+            return Mode::kSoft1;
+        case 4:
+            return Mode::kSoft2;
+        case 5:
+            return Mode::kSoft3;
+        case 6:
+            return Mode::kSaturation;
+        case 7:
+            return Mode::kBitCrush;
+    }
+    
+    return Mode::kHard;
+}
+
+template <typename SampleType>
+void UltimateDistortionAudioProcessor::updateChain(ProcessingChain<SampleType>& chain, Parameters::Mask changes)
+{
+    using ChainDistortion = Distortion<SampleType>;
+    
+    auto hasChanged = [changes] (ParameterIndex index) { return (changes & Parameters::getFlag(index)) != 0; };
+    
+    // The B snapshot is blended into the first band's MODE, GAIN and MIX and into TONE and OUTPUT.
+    // The numbers are interpolated here and ramped by the smoothers; the modes are crossfaded by the distortion.
+    const auto morph = parameters.get(kMorphParameter);
+    
+    auto hasMorphedChanged = [&hasChanged] (ParameterIndex a, ParameterIndex b)
+    {
+        return hasChanged(a) || hasChanged(b) || hasChanged(kMorphParameter);
+    };
+    
+    auto getMorphed = [this, morph] (ParameterIndex a, ParameterIndex b)
+    {
+        return parameters.get(a) + morph * (parameters.get(b) - parameters.get(a));
+    };
+    
+    if (hasChanged(kBandsParameter))
+        chain.distortion.setNumBands(static_cast<int>(parameters.get(kBandsParameter)) + 1);
+    
+    for (auto index : { kCrossover1Parameter, kCrossover2Parameter, kCrossover3Parameter })
+        if (hasChanged(index))
+            chain.distortion.setCrossoverFrequency(index - kCrossover1Parameter, parameters.get(index));
+    
+    for (int band = 0; band < MultibandDistortion<SampleType>::maxBands; ++band)
+    {
+        auto& bandDistortion = chain.distortion.getBand(band);
+        auto modeParameter = getBandParameter(band, kBandMode);
+        auto gainParameter = getBandParameter(band, kBandGain);
+        auto mixParameter = getBandParameter(band, kBandMix);
+        
+        if (hasChanged(modeParameter))
+            bandDistortion.setMode(getMode<SampleType>(static_cast<int>(parameters.get(modeParameter))));
+        
+        if (band == 0)
         {
-            distortion.setMode(Distortion<float>::Mode::kSoft1);
-            break;
+            if (hasChanged(kMorphModeParameter))
+                bandDistortion.setMorphMode(getMode<SampleType>(static_cast<int>(parameters.get(kMorphModeParameter))));
+            
+            if (hasChanged(kMorphParameter))
+                bandDistortion.setMorph(morph);
+            
+            if (hasMorphedChanged(kGainParameter, kMorphGainParameter))
+                bandDistortion.setGain(getMorphed(kGainParameter, kMorphGainParameter));
+            
+            if (hasMorphedChanged(kMixParameter, kMorphMixParameter))
+                bandDistortion.setMix(getMorphed(kMixParameter, kMorphMixParameter));
         }
-        case 4:
+        else
         {
-            distortion.setMode(Distortion<float>::Mode::kSoft2);
-            break;
+            if (hasChanged(gainParameter))
+                bandDistortion.setGain(parameters.get(gainParameter));
+            
+            if (hasChanged(mixParameter))
+                bandDistortion.setMix(parameters.get(mixParameter));
         }
-        case 5:
+        
+        if (hasChanged(kAntialiasingParameter))
         {
-            distortion.setMode(Distortion<float>::Mode::kSoft3);
-            break;
+            auto antialiasing = static_cast<int>(parameters.get(kAntialiasingParameter));
+            bandDistortion.setAntialiasing(static_cast<typename ChainDistortion::Antialiasing>(antialiasing));
         }
-        case 6:
+        
+        if (hasMorphedChanged(kOutputParameter, kMorphOutputParameter))
+            bandDistortion.setOutput(getMorphed(kOutputParameter, kMorphOutputParameter));
+        
+        if (hasChanged(kBitsParameter))
+            bandDistortion.setBitDepth(parameters.get(kBitsParameter));
+        
+        if (hasChanged(kCrushRateParameter))
         {
-            distortion.setMode(Distortion<float>::Mode::kSaturation);
-            break;
+            auto rate = parameters.get(kCrushRateParameter);
+            bandDistortion.setCrushRate(rate < maxCrushRate ? rate : 0.0f);
         }
-        case 7:
+        
+        if (hasChanged(kDitherParameter))
+            bandDistortion.setDither(parameters.get(kDitherParameter) >= 0.5f);
+        
+        if (hasChanged(kStereoParameter))
         {
-            distortion.setMode(Distortion<float>::Mode::kBitCrush);
-            break;
+            auto stereoMode = static_cast<int>(parameters.get(kStereoParameter));
+            bandDistortion.setStereoMode(static_cast<typename ChainDistortion::StereoMode>(stereoMode));
         }
+        
+        if (hasChanged(kSideGainParameter))
+            bandDistortion.setSideGain(parameters.get(kSideGainParameter));
+        
+        if (hasChanged(kSideMixParameter))
+            bandDistortion.setSideMix(parameters.get(kSideMixParameter));
+        
+        // Offline renders always get the exact curves, whatever is chosen for live playback
+        using Precision = typename ChainDistortion::Precision;
+        bandDistortion.setPrecision(isNonRealtime() ? Precision::kExact : static_cast<Precision>(static_cast<int>(parameters.get(kPrecisionParameter))));
+    }
+    
+    if (hasChanged(kEnvelopeDepthParameter))
+        chain.envelope.setDepth(parameters.get(kEnvelopeDepthParameter));
+    
+    if (hasChanged(kAttackParameter))
+        chain.envelope.setAttack(parameters.get(kAttackParameter));
+    
+    if (hasChanged(kReleaseParameter))
+        chain.envelope.setRelease(parameters.get(kReleaseParameter));
+    
+    if (hasMorphedChanged(kToneParameter, kMorphToneParameter))
+        chain.toneFilter.setCutoffFrequency(getMorphed(kToneParameter, kMorphToneParameter));
+    
+    if (hasChanged(kCabinetParameter))
+        cabinet.setEnabled(static_cast<int>(parameters.get(kCabinetParameter)) != static_cast<int>(Cabinet::Model::kOff));
+    
+    if (hasChanged(kCabinetMixParameter))
+        cabinet.setMix(parameters.get(kCabinetMixParameter));
+    
+    // An oversampler that is still being built keeps being asked for, and the previous one runs
+    // until it's ready
+    if (hasChanged(kOversamplingParameter) || hasChanged(kOversamplingFilterParameter) || chain.isOversamplerPending)
+    {
+        auto oversampler = getRequestedOversampler();
+        chain.isOversamplerPending = oversampler >= 0 && ! chain.isOversamplerReady[static_cast<size_t>(oversampler)].load(std::memory_order_acquire);
+        
+        if (oversampler != chain.activeOversampler && ! chain.isOversamplerPending)
+            setActiveOversampler(chain, oversampler);
     }
+}
+
+int UltimateDistortionAudioProcessor::getRequestedOversampler() const noexcept
+{
+    auto stages = static_cast<int>(parameters.get(kOversamplingParameter));
+    auto filterType = static_cast<int>(parameters.get(kOversamplingFilterParameter));
     
-    distortion.setGain(treeState.getRawParameterValue("GAIN")->load());
-    distortion.setMix(treeState.getRawParameterValue("MIX")->load());
-    distortion.setOutput(treeState.getRawParameterValue("OUTPUT")->load());
+    return stages > 0 ? filterType * maxOversamplingStages + stages - 1 : -1;
+}
+
+template <typename SampleType>
+int UltimateDistortionAudioProcessor::getOversamplerLatency(const ProcessingChain<SampleType>& chain, int oversampler)
+{
+    if (juce::isPositiveAndBelow(oversampler, numOversamplers))
+        return juce::roundToInt(chain.oversamplers[static_cast<size_t>(oversampler)]->getLatencyInSamples());
     
-    lpFilter.setCutoffFrequency(treeState.getRawParameterValue("TONE")->load());
+    return 0;
+}
+
+template <typename SampleType>
+void UltimateDistortionAudioProcessor::setActiveOversampler(ProcessingChain<SampleType>& chain, int oversampler)
+{
+    jassert (oversampler < 0 || chain.isOversamplerReady[static_cast<size_t>(oversampler)].load());
+    
+    chain.activeOversampler = oversampler;
+    
+    auto factor = 1;
+    
+    if (oversampler >= 0)
+    {
+        auto& active = *chain.oversamplers[static_cast<size_t>(oversampler)];
+        active.reset();
+        factor = static_cast<int>(active.getOversamplingFactor());
+    }
+    
+    chain.oversamplingFactor = factor;
+    chain.distortion.setOversamplingStages(oversampler >= 0 ? oversampler % maxOversamplingStages + 1 : 0);
+    chain.distortion.setControlInterval(static_cast<size_t>(controlInterval * factor));
+    
+    auto latency = getOversamplerLatency(chain, oversampler);
+    chain.bypassDelay.setDelay(static_cast<SampleType>(latency));
+    updateTailLength(chain);
+    
+    // Telling the host notifies it synchronously, so that is left to the message thread
+    if (pendingLatency.exchange(latency) != latency)
+        triggerAsyncUpdate();
+}
+
+void UltimateDistortionAudioProcessor::updateLatency()
+{
+    const auto latency = pendingLatency.load();
+    
+    if (latency != getLatencySamples())
+        setLatencySamples(latency);
 }
 //==============================================================================
 const juce::String UltimateDistortionAudioProcessor::getName() const
@@ -150,31 +466,53 @@ bool UltimateDistortionAudioProcessor::isMidiEffect() const
 
 double UltimateDistortionAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Silence in gives silence out of every mode, so only the resampling filters, the crossover, the cabinet
+    // and the TONE filter ring on
+    auto latencySeconds = getSampleRate() > 0 ? getLatencySamples() / getSampleRate() : 0.0;
+    
+    return latencySeconds + MultibandDistortion<double>::tailLengthSeconds + cabinet.getTailLengthSeconds()
+         + ToneFilter<double>::tailLengthSeconds;
 }
 
 int UltimateDistortionAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return juce::jmax(1, presets.getNumPresets());
 }
 
 int UltimateDistortionAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram.load();
 }
 
 void UltimateDistortionAudioProcessor::setCurrentProgram (int index)
 {
+    if (! juce::isPositiveAndBelow(index, presets.getNumPresets()))
+        return;
+    
+    currentProgram.store(index);
+    
+    // Applying notifies the host and every parameter listener, which takes locks. Hosts may switch
+    // programs from the audio thread, so there it is left to the next async update.
+    if (juce::MessageManager::existsAndIsCurrentThread())
+    {
+        pendingProgram.store(-1);
+        presets.apply(index);
+        return;
+    }
+    
+    pendingProgram.store(index);
+    triggerAsyncUpdate();
 }
 
 const juce::String UltimateDistortionAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return presets.getName(index);
 }
 
 void UltimateDistortionAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    // The factory bank is read-only
+    juce::ignoreUnused(index, newName);
 }
 
 //==============================================================================
@@ -187,11 +525,103 @@ void UltimateDistortionAudioProcessor::prepareToPlay (double sampleRate, int sam
     spec.sampleRate = sampleRate;
     spec.numChannels = getTotalNumOutputChannels();
     
-    distortion.prepare(spec);
+    hostSampleRate = sampleRate;
     
-    lpFilter.prepare(spec);
+    // The host picks the precision before preparing, so only that chain needs any memory
+    if (isUsingDoublePrecision())
+    {
+        releaseOversamplers(floatChain);
+        prepareChain(doubleChain, spec);
+    }
+    else
+    {
+        releaseOversamplers(doubleChain);
+        prepareChain(floatChain, spec);
+    }
     
-    updateParameters();
+    // Both chains share the cabinet. Preparing it keeps the loaded response, resampled to the new rate.
+    cabinet.prepare(spec);
+    updateCabinet();
+}
+
+template <typename SampleType>
+void UltimateDistortionAudioProcessor::prepareChain(ProcessingChain<SampleType>& chain, const juce::dsp::ProcessSpec& spec)
+{
+    releaseOversamplers(chain);
+    
+    {
+        const juce::ScopedLock scope (oversamplerLock);
+        chain.spec = spec;
+    }
+    
+    // The first block only needs the oversampler the parameters ask for
+    const auto oversampler = getRequestedOversampler();
+    buildOversampler(chain, oversampler);
+    
+    // The distortion takes oversampled blocks in host-sized pieces, so its buffers don't grow with the factor
+    auto distortionSpec = spec;
+    chain.distortion.prepare(distortionSpec);
+    
+    chain.toneFilter.prepare(spec);
+    
+    chain.envelope.prepare(spec.sampleRate, static_cast<int>(spec.maximumBlockSize));
+    chain.envelope.setControlInterval(controlInterval);
+    
+    chain.bypassDelay.setMaximumDelayInSamples(maxOversamplingLatency + 1);
+    chain.bypassDelay.prepare(spec);
+    
+    chain.silentBlocks = 0;
+    chain.silentSamples = 0;
+    
+    setActiveOversampler(chain, oversampler);
+    updateChain(chain, Parameters::allParameters);
+    
+    // prepareToPlay is the one place the host expects a new latency straight away
+    updateLatency();
+}
+
+template <typename SampleType>
+void UltimateDistortionAudioProcessor::buildOversampler(ProcessingChain<SampleType>& chain, int oversampler)
+{
+    const juce::ScopedLock scope (oversamplerLock);
+    
+    if (! juce::isPositiveAndBelow(oversampler, numOversamplers) || chain.spec.maximumBlockSize == 0)
+        return;
+    
+    const auto index = static_cast<size_t>(oversampler);
+    
+    if (chain.isOversamplerReady[index].load(std::memory_order_acquire))
+        return;
+    
+    // The same order as getRequestedOversampler(): the IIR filters first, then the FIR ones
+    const auto filterType = oversampler < maxOversamplingStages ? juce::dsp::Oversampling<SampleType>::filterHalfBandPolyphaseIIR
+                                                                : juce::dsp::Oversampling<SampleType>::filterHalfBandFIREquiripple;
+    const auto stages = oversampler % maxOversamplingStages + 1;
+    
+    auto newOversampler = std::make_unique<juce::dsp::Oversampling<SampleType>>(chain.spec.numChannels, stages, filterType, true, true);
+    newOversampler->initProcessing(chain.spec.maximumBlockSize);
+    
+    jassert (newOversampler->getLatencyInSamples() <= maxOversamplingLatency);
+    
+    // The audio thread doesn't touch a slot until it's marked ready
+    chain.oversamplers[index] = std::move(newOversampler);
+    chain.isOversamplerReady[index].store(true, std::memory_order_release);
+}
+
+template <typename SampleType>
+void UltimateDistortionAudioProcessor::releaseOversamplers(ProcessingChain<SampleType>& chain)
+{
+    const juce::ScopedLock scope (oversamplerLock);
+    
+    for (size_t i = 0; i < chain.oversamplers.size(); ++i)
+    {
+        chain.isOversamplerReady[i].store(false, std::memory_order_relaxed);
+        chain.oversamplers[i].reset();
+    }
+    
+    chain.activeOversampler = -1;
+    chain.isOversamplerPending = false;
+    chain.spec = {};
 }
 
 void UltimateDistortionAudioProcessor::releaseResources()
@@ -214,13 +644,24 @@ bool UltimateDistortionAudioProcessor::isBusesLayoutSupported (const BusesLayout
     if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
      && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
-
+    
     // This checks if the input layout matches the output layout
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+    
+    // The sidechain only feeds the envelope, which takes any mono or stereo signal
+    if (layouts.inputBuses.size() > 1)
+    {
+        const auto sidechain = layouts.getChannelSet(true, 1);
+        
+        if (! sidechain.isDisabled()
+         && sidechain != juce::AudioChannelSet::mono()
+         && sidechain != juce::AudioChannelSet::stereo())
+            return false;
+    }
    #endif
-
+    
     return true;
   #endif
 }
@@ -228,10 +669,26 @@ bool UltimateDistortionAudioProcessor::isBusesLayoutSupported (const BusesLayout
 
 void UltimateDistortionAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels  = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
+    processChain(floatChain, buffer);
+}
 
+void UltimateDistortionAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processChain(doubleChain, buffer);
+}
+
+template <typename SampleType>
+void UltimateDistortionAudioProcessor::processChain(ProcessingChain<SampleType>& chain, juce::AudioBuffer<SampleType>& hostBuffer)
+{
+    juce::ScopedNoDenormals noDenormals;
+    UD_INSTRUMENT_BLOCK(instrumentation, hostBuffer.getNumSamples(), hostSampleRate);
+    
+    // The host buffer also carries the sidechain; everything but the envelope works on the main bus,
+    // whose inputs are the first channels of its outputs
+    auto buffer = getBusBuffer(hostBuffer, false, 0);
+    auto totalNumInputChannels  = getMainBusNumInputChannels();
+    auto totalNumOutputChannels = getMainBusNumOutputChannels();
+    
     // In case we have more outputs than inputs, this code clears any output
     // channels that didn't contain input data, (because these aren't
     // guaranteed to be empty - they may contain garbage).
@@ -240,11 +697,215 @@ void UltimateDistortionAudioProcessor::processBlock (juce::AudioBuffer<float>& b
     // this code if your algorithm always overwrites all the output channels.
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
+    
+    // The bypass delay always holds the latest dry input, so bypassing carries straight on from
+    // this block instead of replaying whatever the last bypass left behind
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    {
+        const auto* samples = buffer.getReadPointer(channel);
+        
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            chain.bypassDelay.pushSample(channel, samples[i]);
+            chain.bypassDelay.popSample(channel);
+        }
+    }
+    
+    updateChain(chain, parameters.consumeChanges());
+    
+    const auto shouldMeter = isMetering.load(std::memory_order_relaxed);
+    const auto shouldAnalyze = isAnalyzing.load(std::memory_order_acquire);
+    LevelFrame levels;
+    
+    if (shouldMeter)
+        LevelFifo::measure(buffer, totalNumInputChannels, levels.inputPeak, levels.inputRms);
+    
+    if (shouldAnalyze)
+        analyzerFifo->pushInput(buffer, totalNumInputChannels);
+    
+    // The envelope keeps following its input while the rest of the chain is idle, so a long RELEASE
+    // is where it should be when sound comes back rather than wherever the silence caught it
+    updateDriveModulation(chain, buffer, hostBuffer);
+    
+    // Once the input has been silent for long enough and the tail has died away there is nothing to compute
+    if (updateSilence(chain, buffer))
+    {
+        buffer.clear();
+        
+        if (shouldMeter)
+            levelFifo.push(levels);
+        
+        if (shouldAnalyze)
+            analyzerFifo->pushOutput(buffer, totalNumOutputChannels);
+        
+        return;
+    }
+    
+    juce::dsp::AudioBlock<SampleType> block {buffer};
+    
+    // The dry signal for MIX is blended inside the distortion at the oversampled rate, so it goes
+    // through the same resampling filters as the wet signal and stays aligned with it
+    if (chain.activeOversampler >= 0)
+    {
+        auto* oversampler = chain.oversamplers[static_cast<size_t>(chain.activeOversampler)].get();
+        juce::dsp::AudioBlock<SampleType> oversampledBlock;
+        
+        {
+            UD_INSTRUMENT_STAGE(instrumentation, kOversampling);
+            oversampledBlock = oversampler->processSamplesUp(block);
+        }
+        
+        {
+            UD_INSTRUMENT_STAGE(instrumentation, kDistortion);
+            chain.distortion.process(juce::dsp::ProcessContextReplacing<SampleType>(oversampledBlock));
+        }
+        
+        {
+            UD_INSTRUMENT_STAGE(instrumentation, kOversampling);
+            oversampler->processSamplesDown(block);
+        }
+    }
+    else
+    {
+        UD_INSTRUMENT_STAGE(instrumentation, kDistortion);
+        chain.distortion.process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+    }
+    
+    {
+        UD_INSTRUMENT_STAGE(instrumentation, kCabinet);
+        cabinet.process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+    }
+    
+    // The cabinet's tail changes when a new response is swapped in or the stage stops
+    if (cabinet.getTailLengthSamples() != chain.cabinetTailSamples)
+        updateTailLength(chain);
+    
+    {
+        UD_INSTRUMENT_STAGE(instrumentation, kToneFilter);
+        chain.toneFilter.process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+    }
+    
+    if (shouldMeter)
+    {
+        LevelFifo::measure(buffer, totalNumOutputChannels, levels.outputPeak, levels.outputRms);
+        levelFifo.push(levels);
+    }
+    
+    if (shouldAnalyze)
+        analyzerFifo->pushOutput(buffer, totalNumOutputChannels);
+}
+
+template <typename SampleType>
+void UltimateDistortionAudioProcessor::updateDriveModulation(ProcessingChain<SampleType>& chain, const juce::AudioBuffer<SampleType>& mainBuffer, juce::AudioBuffer<SampleType>& hostBuffer)
+{
+    if (! chain.envelope.isActive())
+    {
+        chain.distortion.setDriveModulation(nullptr, 0, 0);
+        return;
+    }
+    
+    // A sidechain the host hasn't connected falls back to the main input
+    auto sidechain = getBusCount(true) > 1 ? getBusBuffer(hostBuffer, true, 1) : juce::AudioBuffer<SampleType>();
+    const auto useSidechain = parameters.get(kEnvelopeSourceParameter) >= 0.5f && sidechain.getNumChannels() > 0;
+    const auto& detector = useSidechain ? sidechain : mainBuffer;
+    
+    // The offsets are for host-rate intervals, which the distortion sees oversampled
+    const auto* offsets = chain.envelope.process(detector, detector.getNumChannels());
+    chain.distortion.setDriveModulation(offsets, chain.envelope.getNumOffsets(), static_cast<size_t>(controlInterval * chain.oversamplingFactor));
+}
+
+template <typename SampleType>
+bool UltimateDistortionAudioProcessor::updateSilence(ProcessingChain<SampleType>& chain, const juce::AudioBuffer<SampleType>& buffer)
+{
+    const auto numSamples = buffer.getNumSamples();
+    const auto threshold = static_cast<SampleType>(silenceThreshold);
+    auto isSilent = true;
+    
+    for (int channel = 0; channel < buffer.getNumChannels() && isSilent; ++channel)
+    {
+        auto range = juce::FloatVectorOperations::findMinAndMax(buffer.getReadPointer(channel), numSamples);
+        isSilent = range.getStart() > -threshold && range.getEnd() < threshold;
+    }
+    
+    if (! isSilent)
+    {
+        chain.silentBlocks = 0;
+        chain.silentSamples = 0;
+        return false;
+    }
+    
+    chain.silentBlocks = juce::jmin(chain.silentBlocks + 1, std::numeric_limits<int>::max() - 1);
+    chain.silentSamples += numSamples;
+    
+    // Every output sample of this block has to lie more than the tail after the last sound,
+    // so the silence must cover this block plus a whole tail before it
+    return chain.silentBlocks >= silentBlocksBeforeIdle.load()
+        && chain.silentSamples - numSamples >= chain.tailSamples;
+}
 
-    juce::dsp::AudioBlock<float> block {buffer};
+template <typename SampleType>
+void UltimateDistortionAudioProcessor::updateTailLength(ProcessingChain<SampleType>& chain) noexcept
+{
+    // The same parts as getTailLengthSeconds(), but with the latency of the oversampler actually running
+    constexpr auto filterTailSeconds = MultibandDistortion<double>::tailLengthSeconds + ToneFilter<double>::tailLengthSeconds;
+    
+    chain.cabinetTailSamples = cabinet.getTailLengthSamples();
+    chain.tailSamples = getOversamplerLatency(chain, chain.activeOversampler) + chain.cabinetTailSamples
+                      + static_cast<juce::int64>(std::ceil(filterTailSeconds * hostSampleRate));
+}
+
+void UltimateDistortionAudioProcessor::setAnalyzerEnabled(bool shouldBeEnabled)
+{
+    // The fifo has to exist before the audio thread is told to fill it, and stays until the processor goes
+    if (shouldBeEnabled)
+        getAnalyzerFifo();
     
-    distortion.process(juce::dsp::ProcessContextReplacing<float>(block));
-    lpFilter.process(juce::dsp::ProcessContextReplacing<float>(block));
+    isAnalyzing.store(shouldBeEnabled, std::memory_order_release);
+}
+
+AnalyzerFifo& UltimateDistortionAudioProcessor::getAnalyzerFifo()
+{
+    if (analyzerFifo == nullptr)
+        analyzerFifo = std::make_unique<AnalyzerFifo>();
+    
+    return *analyzerFifo;
+}
+
+void UltimateDistortionAudioProcessor::setSilentBlocksBeforeIdle(int numBlocks) noexcept
+{
+    silentBlocksBeforeIdle.store(juce::jmax(0, numBlocks));
+}
+
+void UltimateDistortionAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processChainBypassed(floatChain, buffer);
+}
+
+void UltimateDistortionAudioProcessor::processBlockBypassed (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processChainBypassed(doubleChain, buffer);
+}
+
+template <typename SampleType>
+void UltimateDistortionAudioProcessor::processChainBypassed(ProcessingChain<SampleType>& chain, juce::AudioBuffer<SampleType>& hostBuffer)
+{
+    auto buffer = getBusBuffer(hostBuffer, false, 0);
+    
+    // Keep the reported latency while bypassed so the host's delay compensation stays valid
+    for (auto i = getMainBusNumInputChannels(); i < getMainBusNumOutputChannels(); ++i)
+        buffer.clear (i, 0, buffer.getNumSamples());
+    
+    updateChain(chain, parameters.consumeChanges());
+    
+    juce::dsp::AudioBlock<SampleType> block {buffer};
+    chain.bypassDelay.process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+}
+
+bool UltimateDistortionAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    // Every stage runs in double except the cabinet: juce::dsp::Convolution is float only, so with a
+    // cabinet selected its wet signal is convolved in float and converted back
+    return true;
 }
 
 //==============================================================================
@@ -261,19 +922,72 @@ juce::AudioProcessorEditor* UltimateDistortionAudioProcessor::createEditor()
 //==============================================================================
 void UltimateDistortionAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // Every parameter's plain value, in parameterIDs order. New parameters are only ever appended,
+    // so older states stay readable and newer ones just carry values this build ignores.
+    destData.reset();
+    juce::MemoryOutputStream stream (destData, false);
     
-    auto state = treeState.copyState();
-    std::unique_ptr<juce::XmlElement> xml (state.createXml());
-    copyXmlToBinary (*xml, destData);
+    stream.writeInt(stateMagic);
+    stream.writeInt(stateVersion);
+    stream.writeInt(currentProgram.load());
+    stream.writeInt(parameterObjects.size());
+    
+    for (auto* parameter : parameterObjects)
+        stream.writeFloat(parameter->convertFrom0to1(parameter->getValue()));
+    
+    // Since version 2: the Custom cabinet's file, or an empty string
+    stream.writeString(getCabinetFile().getFullPathName());
 }
 
 void UltimateDistortionAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    // A program still waiting to be applied would overwrite the state loaded here
+    pendingProgram.store(-1);
+    
+    juce::MemoryInputStream stream (data, static_cast<size_t>(juce::jmax(0, sizeInBytes)), false);
+    
+    if (sizeInBytes >= 16 && stream.readInt() == stateMagic)
+    {
+        const auto version = stream.readInt();
+        const auto program = stream.readInt();
+        const auto numStored = stream.readInt();
+        
+        // A state from a later format than this build knows about
+        if (version > stateVersion || numStored < 0)
+            return;
+        
+        for (int i = 0; i < parameterObjects.size(); ++i)
+        {
+            auto* parameter = parameterObjects.getUnchecked(i);
+            
+            // Parameters added since the state was saved take their defaults
+            const auto hasValue = i < numStored && stream.getNumBytesRemaining() >= 4;
+            parameter->setValueNotifyingHost(hasValue ? parameter->convertTo0to1(stream.readFloat())
+                                                      : parameter->getDefaultValue());
+        }
+        
+        // Values of parameters this build doesn't have come before the cabinet file
+        if (numStored > parameterObjects.size())
+            stream.skipNextBytes(4 * static_cast<juce::int64>(numStored - parameterObjects.size()));
+        
+        if (version >= 2)
+        {
+            const auto path = stream.readString();
+            
+            {
+                const juce::ScopedLock scope (cabinetLock);
+                cabinetFile = juce::File::isAbsolutePath(path) ? juce::File(path) : juce::File();
+                loadedModel = Cabinet::Model::kOff;
+            }
+            
+            updateCabinet();
+        }
+        
+        currentProgram.store(juce::isPositiveAndBelow(program, presets.getNumPresets()) ? program : 0);
+        return;
+    }
+    
+    // Sessions saved before the binary format stored the parameter tree as XML
     std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
     
     if (xmlState.get() != nullptr)
@@ -287,3 +1001,6 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 {
     return new UltimateDistortionAudioProcessor();
 }
+
+template Distortion<float>::Mode UltimateDistortionAudioProcessor::getMode<float>(int) noexcept;
+template Distortion<double>::Mode UltimateDistortionAudioProcessor::getMode<double>(int) noexcept;
@@ -10,11 +10,19 @@
 
 #include <JuceHeader.h>
 #include "dsp.h"
+#include "parameters.h"
+#include "tonefilter.h"
+#include "multiband.h"
+#include "instrumentation.h"
+#include "metering.h"
+#include "envelope.h"
+#include "presets.h"
+#include "cabinet.h"
 
 //==============================================================================
 /**
 */
-class UltimateDistortionAudioProcessor  : public juce::AudioProcessor, juce::AudioProcessorValueTreeState::Listener
+class UltimateDistortionAudioProcessor  : public juce::AudioProcessor, juce::AudioProcessorValueTreeState::Listener, juce::AsyncUpdater
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
@@ -23,7 +31,7 @@ public:
     //==============================================================================
     UltimateDistortionAudioProcessor();
     ~UltimateDistortionAudioProcessor() override;
-
+    
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
@@ -31,42 +39,275 @@ public:
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
-
+    
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    
+    bool supportsDoublePrecisionProcessing() const override;
+    
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
-
+    
     //==============================================================================
     const juce::String getName() const override;
-
+    
     bool acceptsMidi() const override;
     bool producesMidi() const override;
     bool isMidiEffect() const override;
     double getTailLengthSeconds() const override;
-
+    
     //==============================================================================
     int getNumPrograms() override;
     int getCurrentProgram() override;
     void setCurrentProgram (int index) override;
     const juce::String getProgramName (int index) override;
     void changeProgramName (int index, const juce::String& newName) override;
-
+    
     //==============================================================================
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
     
     juce::AudioProcessorValueTreeState treeState;
+    
+    /** Sets how many consecutive silent input blocks it takes, on top of the tail having decayed,
+        before processBlock stops running the chain and just outputs silence. */
+    void setSilentBlocksBeforeIdle(int numBlocks) noexcept;
+    
+    /** Turns publishing block levels to getLevelFifo() on or off. The editor switches it on while it
+        is open, so without one the audio thread doesn't measure anything. */
+    void setMeteringEnabled(bool shouldBeEnabled) noexcept { isMetering.store(shouldBeEnabled); }
+    
+    LevelFifo& getLevelFifo() noexcept { return levelFifo; }
+    
+    /** Turns copying the input and output samples to getAnalyzerFifo() on or off, for the editor's
+        spectrum analyzer. Like metering it's only switched on while the editor is open. Message thread only. */
+    void setAnalyzerEnabled(bool shouldBeEnabled);
+    
+    /** The fifo is only allocated the first time an editor asks for it, so instances that are never
+        opened don't carry its buffers. Message thread only. */
+    AnalyzerFifo& getAnalyzerFifo();
+    
+    /** Loads an impulse response file into the cabinet stage and selects it as the Custom cabinet.
+        The file is read in the background and its path is saved with the state. Message thread only. */
+    void loadCabinetFile(const juce::File& file);
+    
+    juce::File getCabinetFile() const;
+    
+    /** The distortion mode selected by a MODE choice index. */
+    template <typename SampleType>
+    static typename Distortion<SampleType>::Mode getMode(int choice) noexcept;
+
+   #if UD_ENABLE_INSTRUMENTATION
+    /** Per-stage block timings of this instance. Safe to read from any thread while audio is running. */
+    Instrumentation& getInstrumentation() noexcept { return instrumentation; }
+   #endif
 
 private:
     
     
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     void parameterChanged (const juce::String& parameterID, float newValue) override;
-    void updateParameters();
-    Distortion<float> distortion;
-    juce::dsp::LinkwitzRileyFilter<float> lpFilter;
+    void handleAsyncUpdate() override;
+    
+    // Slots of the parameter snapshot, in the same order as parameterIDs
+    enum ParameterIndex
+    {
+        kModeParameter,
+        kGainParameter,
+        kMixParameter,
+        kToneParameter,
+        kOutputParameter,
+        kOversamplingParameter,
+        kOversamplingFilterParameter,
+        kAntialiasingParameter,
+        kPrecisionParameter,
+        kBandsParameter,
+        kCrossover1Parameter,
+        kCrossover2Parameter,
+        kCrossover3Parameter,
+        kBand2ModeParameter,
+        kBand2GainParameter,
+        kBand2MixParameter,
+        kBand3ModeParameter,
+        kBand3GainParameter,
+        kBand3MixParameter,
+        kBand4ModeParameter,
+        kBand4GainParameter,
+        kBand4MixParameter,
+        kBitsParameter,
+        kCrushRateParameter,
+        kDitherParameter,
+        kEnvelopeDepthParameter,
+        kAttackParameter,
+        kReleaseParameter,
+        kEnvelopeSourceParameter,
+        kStereoParameter,
+        kSideGainParameter,
+        kSideMixParameter,
+        kMorphModeParameter,
+        kMorphGainParameter,
+        kMorphMixParameter,
+        kMorphToneParameter,
+        kMorphOutputParameter,
+        kMorphParameter,
+        kCabinetParameter,
+        kCabinetMixParameter,
+        kNumParameters
+    };
+    
+    // The settings every band has; the first band uses the main MODE, GAIN and MIX
+    enum BandParameter
+    {
+        kBandMode,
+        kBandGain,
+        kBandMix,
+        kNumBandParameters
+    };
+    
+    static ParameterIndex getBandParameter(int band, BandParameter parameter) noexcept;
+    
+    // Append-only: the binary state stores values by position in this list
+    static const std::array<const char*, kNumParameters> parameterIDs;
+    
+    // The parameters of treeState in parameterIDs order, for the state and the presets
+    juce::Array<juce::RangedAudioParameter*> parameterObjects;
+    
+    PresetBank presets;
+    std::atomic<int> currentProgram { 0 };
+    
+    // A program selected off the message thread and not applied yet, or -1
+    std::atomic<int> pendingProgram { -1 };
+    
+    // "UDst" and the layout of getStateInformation(). Bump the version if the layout changes.
+    static constexpr int stateMagic = 0x74734455;
+    static constexpr int stateVersion = 2;
+    
+    using Parameters = ParameterSnapshot<kNumParameters>;
+    
+    // One oversampler per filter type and number of stages (2x to 16x)
+    static constexpr int maxOversamplingStages = 4;
+    static constexpr int numOversamplers = 2 * maxOversamplingStages;
+    static_assert (maxOversamplingStages == MultibandDistortion<float>::maxOversamplingStages, "The distortion needs a crossover for every factor");
+    
+    // Everything that touches audio, once per precision. Only the chain matching the host's
+    // processing precision is prepared, and it takes the whole parameter snapshot when it is.
+    template <typename SampleType>
+    struct ProcessingChain
+    {
+        MultibandDistortion<SampleType> distortion;
+        ToneFilter<SampleType> toneFilter;
+        
+        // prepareToPlay only builds the oversampler the parameters ask for. Any other one is built
+        // on the message thread when it is first selected, and the audio thread switches to it once
+        // its isOversamplerReady flag is set, so switching never allocates. Index -1 means no oversampling.
+        std::array<std::unique_ptr<juce::dsp::Oversampling<SampleType>>, numOversamplers> oversamplers;
+        std::array<std::atomic<bool>, numOversamplers> isOversamplerReady {};
+        int activeOversampler = -1;
+        int oversamplingFactor = 1;
+        bool isOversamplerPending = false;
+        
+        // What the oversamplers are built for; a maximumBlockSize of 0 means the chain isn't prepared
+        juce::dsp::ProcessSpec spec {};
+        
+        // Runs at the host rate on the main input or the sidechain, one value per controlInterval
+        EnvelopeFollower<SampleType> envelope;
+        
+        juce::dsp::DelayLine<SampleType> bypassDelay;
+        
+        // How long the input has been silent for, in blocks and in samples
+        int silentBlocks = 0;
+        juce::int64 silentSamples = 0;
+        
+        // The tail in host-rate samples, kept by updateTailLength() so silent blocks don't work it out
+        juce::int64 tailSamples = 0;
+        int cabinetTailSamples = 0;
+    };
+    
+    template <typename SampleType>
+    void prepareChain(ProcessingChain<SampleType>& chain, const juce::dsp::ProcessSpec& spec);
+    
+    template <typename SampleType>
+    void updateChain(ProcessingChain<SampleType>& chain, Parameters::Mask changes);
+    
+    template <typename SampleType>
+    void processChain(ProcessingChain<SampleType>& chain, juce::AudioBuffer<SampleType>& hostBuffer);
+    
+    template <typename SampleType>
+    void updateTailLength(ProcessingChain<SampleType>& chain) noexcept;
+    
+    template <typename SampleType>
+    bool updateSilence(ProcessingChain<SampleType>& chain, const juce::AudioBuffer<SampleType>& buffer);
+    
+    template <typename SampleType>
+    void processChainBypassed(ProcessingChain<SampleType>& chain, juce::AudioBuffer<SampleType>& hostBuffer);
+    
+    template <typename SampleType>
+    void updateDriveModulation(ProcessingChain<SampleType>& chain, const juce::AudioBuffer<SampleType>& mainBuffer, juce::AudioBuffer<SampleType>& hostBuffer);
+    
+    int getRequestedOversampler() const noexcept;
+    
+    template <typename SampleType>
+    void buildOversampler(ProcessingChain<SampleType>& chain, int oversampler);
+    
+    template <typename SampleType>
+    void releaseOversamplers(ProcessingChain<SampleType>& chain);
+    
+    template <typename SampleType>
+    void setActiveOversampler(ProcessingChain<SampleType>& chain, int oversampler);
+    
+    template <typename SampleType>
+    static int getOversamplerLatency(const ProcessingChain<SampleType>& chain, int oversampler);
+    
+    /** Reports pendingLatency to the host if it has changed. Message thread only. */
+    void updateLatency();
+    
+    void updateCabinet();
+    
+    ProcessingChain<float> floatChain;
+    ProcessingChain<double> doubleChain;
+    
+    // Written by the parameter listener, applied by the audio thread at the start of each block
+    Parameters parameters;
+    
+    // Guards building and releasing oversamplers, which happens off the audio thread
+    juce::CriticalSection oversamplerLock;
+    
+    // The bypass delay is sized before most oversamplers exist, so it takes this bound instead of
+    // their actual latency. Even the 16x linear phase filters stay far below it.
+    static constexpr int maxOversamplingLatency = 512;
+    
+    // The latency of the active oversampler, set on the audio thread and reported by updateLatency()
+    std::atomic<int> pendingLatency { 0 };
+    
+    // Runs at the host rate after the distortion, for whichever chain is processing. Loading a response
+    // happens on the message thread, under cabinetLock; loadedModel is what was last handed to it.
+    Cabinet cabinet;
+    juce::CriticalSection cabinetLock;
+    Cabinet::Model loadedModel = Cabinet::Model::kOff;
+    juce::File cabinetFile;
+    
+    // Host-rate samples between parameter updates while ramping; scaled by the oversampling factor
+    static constexpr int controlInterval = 16;
+    
+    // The top of the RATE range, which stands for no sample rate reduction at all
+    static constexpr float maxCrushRate = 48000.0f;
+    double hostSampleRate = 44100.0;
+    
+    // Inputs quieter than -120 dB count as silence
+    static constexpr double silenceThreshold = 1.0e-6;
+    std::atomic<int> silentBlocksBeforeIdle { 8 };
+    
+    LevelFifo levelFifo;
+    std::atomic<bool> isMetering { false };
+    std::unique_ptr<AnalyzerFifo> analyzerFifo;
+    std::atomic<bool> isAnalyzing { false };
+
+   #if UD_ENABLE_INSTRUMENTATION
+    Instrumentation instrumentation;
+   #endif
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UltimateDistortionAudioProcessor)
 };
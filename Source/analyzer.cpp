@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    analyzer.cpp
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#include "analyzer.h"
+
+namespace
+{
+    // Blackman-Harris keeps the leakage of a full-scale fundamental under the aliasing we're after;
+    // its main lobe spans four bins either side, so a harmonic owns anything within this distance
+    constexpr float harmonicToleranceBins = 5.0f;
+
+    // Inputs quieter than this have no fundamental worth measuring against
+    constexpr float fundamentalThresholdDecibels = -80.0f;
+}
+
+SpectrumAnalyzer::Plan::Plan()
+    : window(static_cast<size_t>(fftSize))
+{
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), window.size(), juce::dsp::WindowingFunction<float>::blackmanHarris, false);
+}
+
+std::shared_ptr<const SpectrumAnalyzer::Plan> SpectrumAnalyzer::getSharedPlan()
+{
+    ResourceKey key;
+    key.resolution = fftOrder;
+    
+    return SharedResourceCache<Plan>::getInstance().get(key, [] { return std::make_shared<const Plan>(); });
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(AnalyzerFifo& fifoToRead)
+    : juce::Thread("Spectrum analyzer"),
+      fifo(fifoToRead),
+      plan(getSharedPlan()),
+      inputHistory(static_cast<size_t>(fftSize)),
+      outputHistory(static_cast<size_t>(fftSize)),
+      inputScratch(static_cast<size_t>(fftSize)),
+      outputScratch(static_cast<size_t>(fftSize)),
+      fftData(static_cast<size_t>(2 * fftSize))
+{
+    analyzed.input.fill(minimumDecibels);
+    analyzed.output.fill(minimumDecibels);
+    analyzed.inharmonic.fill(minimumDecibels);
+    
+    startThread();
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    stopThread(1000);
+}
+
+bool SpectrumAnalyzer::getSpectrum(Spectrum& destination)
+{
+    // The analyzer only holds the lock while copying, so when it's busy the next tick will do
+    const juce::SpinLock::ScopedTryLockType lock (spectrumLock);
+    
+    if (! lock.isLocked() || ! hasNewSpectrum)
+        return false;
+    
+    destination = published;
+    hasNewSpectrum = false;
+    return true;
+}
+
+void SpectrumAnalyzer::run()
+{
+    while (! threadShouldExit())
+    {
+        auto hasNewSamples = false;
+        
+        while (const auto numSamples = fifo.pop(inputScratch.data(), outputScratch.data(), fftSize))
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                inputHistory[static_cast<size_t>(historyPosition)] = inputScratch[static_cast<size_t>(i)];
+                outputHistory[static_cast<size_t>(historyPosition)] = outputScratch[static_cast<size_t>(i)];
+                historyPosition = (historyPosition + 1) % fftSize;
+            }
+            
+            hasNewSamples = true;
+        }
+        
+        if (hasNewSamples)
+            analyze();
+        
+        wait(1000 / maxFramesPerSecond);
+    }
+}
+
+void SpectrumAnalyzer::analyze()
+{
+    transform(inputHistory, analyzed.input);
+    transform(outputHistory, analyzed.output);
+    findInharmonic(analyzed);
+    
+    const juce::SpinLock::ScopedLockType lock (spectrumLock);
+    published = analyzed;
+    hasNewSpectrum = true;
+}
+
+void SpectrumAnalyzer::transform(const std::vector<float>& history, std::array<float, numBins>& magnitudes)
+{
+    const auto oldest = history.begin() + historyPosition;
+    std::copy(oldest, history.end(), fftData.begin());
+    std::copy(history.begin(), oldest, fftData.begin() + (history.end() - oldest));
+    std::fill(fftData.begin() + fftSize, fftData.end(), 0.0f);
+    
+    juce::FloatVectorOperations::multiply(fftData.data(), plan->window.data(), fftSize);
+    plan->fft.performFrequencyOnlyForwardTransform(fftData.data());
+    
+    // Scaled so a full-scale sine reads 0 dB: both sides of the spectrum, over the window's gain
+    const auto scale = 2.0f / (fftSize * 0.35875f);
+    
+    for (size_t bin = 0; bin < magnitudes.size(); ++bin)
+        magnitudes[bin] = juce::Decibels::gainToDecibels(fftData[bin] * scale, minimumDecibels);
+}
+
+void SpectrumAnalyzer::findInharmonic(Spectrum& spectrum) const noexcept
+{
+    spectrum.inharmonic.fill(minimumDecibels);
+    spectrum.fundamentalBin = 0.0f;
+    spectrum.inharmonicDecibels = minimumDecibels;
+    
+    const auto first = spectrum.input.begin() + 1;
+    const auto last = spectrum.input.end() - 1;
+    const auto peak = std::max_element(first, last);
+    
+    if (*peak < fundamentalThresholdDecibels)
+        return;
+    
+    // Parabolic interpolation of the peak in dB gets the fundamental to a fraction of a bin,
+    // which matters because the error grows with every harmonic
+    const auto bin = static_cast<int>(peak - spectrum.input.begin());
+    const auto below = spectrum.input[static_cast<size_t>(bin - 1)];
+    const auto above = spectrum.input[static_cast<size_t>(bin + 1)];
+    const auto curvature = below - 2.0f * *peak + above;
+    const auto offset = curvature < 0.0f ? 0.5f * (below - above) / curvature : 0.0f;
+    const auto fundamental = static_cast<float>(bin) + offset;
+    
+    // Harmonics closer together than their main lobes leave nothing between them to measure
+    if (fundamental < 2.0f * harmonicToleranceBins)
+        return;
+    
+    spectrum.fundamentalBin = fundamental;
+    
+    auto totalPower = 0.0;
+    auto inharmonicPower = 0.0;
+    
+    for (size_t k = 0; k < spectrum.output.size(); ++k)
+    {
+        const auto power = std::pow(10.0, spectrum.output[k] / 10.0);
+        totalPower += power;
+        
+        // Harmonic 0 is DC, which the rectifying modes produce on purpose
+        const auto harmonic = std::round(static_cast<float>(k) / fundamental);
+        
+        if (std::abs(static_cast<float>(k) - harmonic * fundamental) > harmonicToleranceBins)
+        {
+            spectrum.inharmonic[k] = spectrum.output[k];
+            inharmonicPower += power;
+        }
+    }
+    
+    if (totalPower > 0.0 && inharmonicPower > 0.0)
+        spectrum.inharmonicDecibels = juce::jmax(minimumDecibels, static_cast<float>(10.0 * std::log10(inharmonicPower / totalPower)));
+}
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    analyzer.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "metering.h"
+#include "resources.h"
+
+/** Computes input and output spectra from an AnalyzerFifo on its own thread, at most
+    maxFramesPerSecond times a second, so none of the FFT work lands on the audio or the message
+    thread.
+
+    Besides the two spectra it separates the inharmonic part of the output: everything that isn't
+    near a multiple of the input's fundamental. With a sine at the input, that is the aliasing the
+    oversampling and ADAA settings leave behind (plus any noise). */
+class SpectrumAnalyzer : private juce::Thread
+{
+public:
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int numBins = fftSize / 2;
+    static constexpr int maxFramesPerSecond = 30;
+    static constexpr float minimumDecibels = -120.0f;
+    
+    struct Spectrum
+    {
+        std::array<float, numBins> input, output, inharmonic;
+        
+        /** The strongest input bin, with parabolic interpolation; 0 if the input is silent. */
+        float fundamentalBin = 0.0f;
+        
+        /** Inharmonic output power relative to the total output power. */
+        float inharmonicDecibels = minimumDecibels;
+    };
+    
+    explicit SpectrumAnalyzer(AnalyzerFifo& fifoToRead);
+    ~SpectrumAnalyzer() override;
+    
+    /** Copies the newest spectrum into the given one. Returns false, leaving it untouched, if
+        nothing new has been computed since the last call. Message thread only. */
+    bool getSpectrum(Spectrum& destination);
+
+private:
+    void run() override;
+    
+    void analyze();
+    
+    void transform(const std::vector<float>& history, std::array<float, numBins>& magnitudes);
+    
+    void findInharmonic(Spectrum& spectrum) const noexcept;
+    
+    // The FFT and its window, shared by every open analyzer. The forward transforms are const and
+    // keep no state between calls, so several analyzer threads can run the same plan at once.
+    struct Plan
+    {
+        Plan();
+        
+        juce::dsp::FFT fft { fftOrder };
+        std::vector<float> window;
+    };
+    
+    static std::shared_ptr<const Plan> getSharedPlan();
+    
+    AnalyzerFifo& fifo;
+    
+    std::shared_ptr<const Plan> plan;
+    
+    // The latest fftSize samples of each stream, oldest first once unrolled from historyPosition
+    std::vector<float> inputHistory, outputHistory, inputScratch, outputScratch, fftData;
+    int historyPosition = 0;
+    
+    Spectrum analyzed;
+    
+    juce::SpinLock spectrumLock;
+    Spectrum published;
+    bool hasNewSpectrum = false;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyzer)
+};
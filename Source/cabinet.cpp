@@ -0,0 +1,259 @@
+/*
+  ==============================================================================
+
+    cabinet.cpp
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#include "cabinet.h"
+
+namespace
+{
+    // The built-in cabinets are rendered from a handful of filters instead of being shipped as
+    // recordings: a resonant high-pass for the speaker's low end, peaks and dips for the cone and
+    // the box, and a steep low-pass for the cone's roll-off. They are rendered at this rate and
+    // resampled like any loaded file.
+    constexpr double designSampleRate = 48000.0;
+    constexpr int designLength = 2048;
+
+    struct Band
+    {
+        enum class Type
+        {
+            kHighPass,
+            kLowPass,
+            kPeak
+        };
+        
+        Type type;
+        float frequency, q, gainDecibels;
+    };
+    
+    struct Design
+    {
+        std::vector<Band> bands;
+        
+        // An open back adds the rear of the cone, delayed and inverted; 0 for a closed box
+        float reflectionMilliseconds, reflectionGain;
+    };
+    
+    // In the order of Cabinet::Model, from the first model after Off
+    const std::vector<Design>& getDesigns()
+    {
+        using Type = Band::Type;
+        
+        static const std::vector<Design> designs
+        {
+            // 4x12 Closed: a tight low-end bump, a scooped middle and a strong presence peak
+            { { { Type::kHighPass, 70.0f, 1.2f, 0.0f }, { Type::kPeak, 110.0f, 1.5f, 3.0f }, { Type::kPeak, 400.0f, 1.0f, -5.0f },
+                { Type::kPeak, 2200.0f, 1.2f, 5.0f }, { Type::kLowPass, 4500.0f, 0.7f, 0.0f }, { Type::kLowPass, 4500.0f, 0.7f, 0.0f } },
+              0.0f, 0.0f },
+            
+            // 2x12 Open: less low end, a brighter top and the comb of the open back
+            { { { Type::kHighPass, 90.0f, 0.8f, 0.0f }, { Type::kPeak, 500.0f, 1.0f, -3.0f }, { Type::kPeak, 2600.0f, 1.4f, 4.0f },
+                { Type::kLowPass, 5500.0f, 0.8f, 0.0f }, { Type::kLowPass, 5500.0f, 0.8f, 0.0f } },
+              1.1f, -0.3f },
+            
+            // 1x12 Combo: thin and forward in the middle
+            { { { Type::kHighPass, 100.0f, 0.9f, 0.0f }, { Type::kPeak, 1200.0f, 0.9f, 3.0f }, { Type::kPeak, 3000.0f, 2.0f, 3.0f },
+                { Type::kLowPass, 5000.0f, 1.0f, 0.0f }, { Type::kLowPass, 5000.0f, 1.0f, 0.0f } },
+              0.8f, -0.35f },
+            
+            // 8x10 Bass: deep, with the top rolled off early
+            { { { Type::kHighPass, 45.0f, 1.0f, 0.0f }, { Type::kPeak, 80.0f, 1.0f, 3.0f }, { Type::kPeak, 700.0f, 0.8f, -4.0f },
+                { Type::kPeak, 1800.0f, 1.5f, 3.0f }, { Type::kLowPass, 3500.0f, 0.7f, 0.0f }, { Type::kLowPass, 3500.0f, 0.7f, 0.0f } },
+              0.0f, 0.0f }
+        };
+        
+        return designs;
+    }
+    
+    juce::dsp::IIR::Coefficients<float>::Ptr makeCoefficients(const Band& band)
+    {
+        using Coefficients = juce::dsp::IIR::Coefficients<float>;
+        
+        switch (band.type)
+        {
+            case Band::Type::kHighPass:
+                return Coefficients::makeHighPass(designSampleRate, band.frequency, band.q);
+            case Band::Type::kLowPass:
+                return Coefficients::makeLowPass(designSampleRate, band.frequency, band.q);
+            case Band::Type::kPeak:
+                break;
+        }
+        
+        return Coefficients::makePeakFilter(designSampleRate, band.frequency, band.q, juce::Decibels::decibelsToGain(band.gainDecibels));
+    }
+    
+    juce::AudioBuffer<float> renderDesign(const Design& design)
+    {
+        juce::AudioBuffer<float> impulse (1, designLength);
+        impulse.clear();
+        
+        auto* samples = impulse.getWritePointer(0);
+        samples[0] = 1.0f;
+        
+        const auto reflection = juce::roundToInt(design.reflectionMilliseconds * 0.001 * designSampleRate);
+        
+        if (reflection > 0)
+            samples[reflection] = design.reflectionGain;
+        
+        for (const auto& band : design.bands)
+        {
+            juce::dsp::IIR::Filter<float> filter (makeCoefficients(band));
+            
+            for (int i = 0; i < designLength; ++i)
+                samples[i] = filter.processSample(samples[i]);
+        }
+        
+        // Every design has died away 70 dB by the end; the fade just keeps the cut clean
+        const auto fadeLength = designLength / 8;
+        impulse.applyGainRamp(designLength - fadeLength, fadeLength, 1.0f, 0.0f);
+        
+        return impulse;
+    }
+}
+
+Cabinet::Cabinet()
+    : loader(getSharedLoader()),
+      convolution(juce::dsp::Convolution::NonUniform { headSize }, loader->queue)
+{
+}
+
+std::shared_ptr<const Cabinet::Loader> Cabinet::getSharedLoader()
+{
+    return SharedResourceCache<Loader>::getInstance().get({}, [] { return std::make_shared<const Loader>(); });
+}
+
+void Cabinet::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    sampleRate = spec.sampleRate;
+    convolution.prepare(spec);
+    wetBuffer.setSize(static_cast<int>(spec.numChannels), static_cast<int>(spec.maximumBlockSize));
+    
+    // The non-uniform partitioning convolves its head directly, so the plugin's latency is unchanged
+    jassert (convolution.getLatency() == 0);
+    
+    wet.reset(spec.sampleRate, 0.05);
+    reset();
+}
+
+void Cabinet::reset() noexcept
+{
+    convolution.reset();
+    wet.setCurrentAndTargetValue(isEnabled ? mix : 0.0f);
+    isRunning = false;
+}
+
+void Cabinet::loadModel(Model model)
+{
+    if (model == Model::kOff || model == Model::kCustom)
+        return;
+    
+    auto impulse = renderDesign(getDesigns()[static_cast<size_t>(model) - 1]);
+    
+    convolution.loadImpulseResponse(std::move(impulse), designSampleRate, juce::dsp::Convolution::Stereo::no,
+                                    juce::dsp::Convolution::Trim::no, juce::dsp::Convolution::Normalise::yes);
+}
+
+void Cabinet::loadFile(const juce::File& file)
+{
+    // Only the path is handed over here; the file is read on the loader thread
+    convolution.loadImpulseResponse(file, juce::dsp::Convolution::Stereo::yes, juce::dsp::Convolution::Trim::yes,
+                                    0, juce::dsp::Convolution::Normalise::yes);
+}
+
+void Cabinet::setEnabled(bool shouldBeEnabled) noexcept
+{
+    isEnabled = shouldBeEnabled;
+    updateTarget();
+}
+
+void Cabinet::setMix(float newMix) noexcept
+{
+    mix = newMix;
+    updateTarget();
+}
+
+void Cabinet::updateTarget() noexcept
+{
+    wet.setTargetValue(isEnabled ? mix : 0.0f);
+}
+
+template <typename SampleType>
+void Cabinet::process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept
+{
+    // Once it has faded out the stage stops, and starts again from silence when it's switched back in
+    if (! wet.isSmoothing() && wet.getTargetValue() == 0.0f)
+    {
+        if (isRunning)
+        {
+            convolution.reset();
+            isRunning = false;
+            tailSamples = 0;
+            tailSeconds.store(0.0, std::memory_order_relaxed);
+        }
+        
+        return;
+    }
+    
+    isRunning = true;
+    
+    auto& block = context.getOutputBlock();
+    const auto numChannels = juce::jmin(block.getNumChannels(), static_cast<size_t>(wetBuffer.getNumChannels()));
+    const auto numSamples = block.getNumSamples();
+    
+    for (size_t channel = 0; channel < numChannels; ++channel)
+    {
+        const auto* source = block.getChannelPointer(channel);
+        auto* destination = wetBuffer.getWritePointer(static_cast<int>(channel));
+        
+        if constexpr (std::is_same<SampleType, float>::value)
+            juce::FloatVectorOperations::copy(destination, source, static_cast<int>(numSamples));
+        else
+            std::transform(source, source + numSamples, destination, [] (SampleType x) { return static_cast<float>(x); });
+    }
+    
+    auto wetBlock = juce::dsp::AudioBlock<float>(wetBuffer).getSubsetChannelBlock(0, numChannels).getSubBlock(0, numSamples);
+    convolution.process(juce::dsp::ProcessContextReplacing<float>(wetBlock));
+    
+    if (convolution.getCurrentIRSize() != tailSamples)
+    {
+        tailSamples = convolution.getCurrentIRSize();
+        tailSeconds.store(tailSamples / sampleRate, std::memory_order_relaxed);
+    }
+    
+    // The block itself is the dry signal, so the mix is done in place
+    if (wet.isSmoothing())
+    {
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const auto gain = static_cast<SampleType>(wet.getNextValue());
+            
+            for (size_t channel = 0; channel < numChannels; ++channel)
+            {
+                auto& sample = block.getChannelPointer(channel)[i];
+                sample += gain * (static_cast<SampleType>(wetBlock.getSample(static_cast<int>(channel), static_cast<int>(i))) - sample);
+            }
+        }
+        
+        return;
+    }
+    
+    const auto gain = static_cast<SampleType>(wet.getCurrentValue());
+    
+    for (size_t channel = 0; channel < numChannels; ++channel)
+    {
+        auto* samples = block.getChannelPointer(channel);
+        const auto* wetSamples = wetBlock.getChannelPointer(channel);
+        
+        for (size_t i = 0; i < numSamples; ++i)
+            samples[i] += gain * (static_cast<SampleType>(wetSamples[i]) - samples[i]);
+    }
+}
+
+template void Cabinet::process<float>(const juce::dsp::ProcessContextReplacing<float>&) noexcept;
+template void Cabinet::process<double>(const juce::dsp::ProcessContextReplacing<double>&) noexcept;
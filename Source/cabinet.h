@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    cabinet.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "resources.h"
+
+/** The optional speaker cabinet after the distortion: one of a few built-in impulse responses, or
+    one loaded from a file, run through juce::dsp::Convolution at the host rate.
+
+    The convolution is non-uniformly partitioned: the head of the response uses small partitions so
+    the stage adds no latency, and the tail uses large FFT partitions so long responses stay cheap.
+    Files are read, resampled to the processing rate and normalised on a loader thread that every
+    instance shares. The audio thread picks up a new response without locking and crossfades to it.
+    While the stage is off and faded out the convolution doesn't run at all.
+*/
+class Cabinet
+{
+public:
+    enum class Model
+    {
+        kOff,
+        kClosed4x12,
+        kOpen2x12,
+        kCombo1x12,
+        kBass8x10,
+        kCustom
+    };
+    
+    // Samples in the low-latency head of the partitioning
+    static constexpr int headSize = 256;
+    
+    Cabinet();
+    
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    
+    void reset() noexcept;
+    
+    /** Starts loading one of the built-in responses; Off and Custom load nothing. Not for the audio thread. */
+    void loadModel(Model model);
+    
+    /** Starts loading a response from an audio file. A stereo file gives each channel its own response.
+        Not for the audio thread. */
+    void loadFile(const juce::File& file);
+    
+    /** Switches the stage in or out, fading over the same time as a change of mix. */
+    void setEnabled(bool shouldBeEnabled) noexcept;
+    
+    void setMix(float newMix) noexcept;
+    
+    template <typename SampleType>
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept;
+    
+    /** How long the current response rings on, or 0 while the stage isn't running. Safe from any thread. */
+    double getTailLengthSeconds() const noexcept { return tailSeconds.load(std::memory_order_relaxed); }
+    
+    /** The same in samples at the processing rate, for the audio thread. */
+    int getTailLengthSamples() const noexcept { return tailSamples; }
+
+private:
+    // The convolution's background thread. It is thread-safe, so one instance serves every plugin.
+    struct Loader
+    {
+        mutable juce::dsp::ConvolutionMessageQueue queue;
+    };
+    
+    static std::shared_ptr<const Loader> getSharedLoader();
+    
+    void updateTarget() noexcept;
+    
+    // Declared before the convolution, which keeps using the queue until it is destroyed
+    std::shared_ptr<const Loader> loader;
+    juce::dsp::Convolution convolution;
+    
+    // The wet signal. juce::dsp::Convolution only takes float, so the double chain converts into it and the
+    // cabinet's wet signal has float precision there; the dry part of CABMIX stays in double.
+    juce::AudioBuffer<float> wetBuffer;
+    
+    juce::SmoothedValue<float> wet;
+    float mix = 1.0f;
+    bool isEnabled = false;
+    bool isRunning = false;
+    
+    double sampleRate = 44100.0;
+    int tailSamples = 0;
+    std::atomic<double> tailSeconds { 0.0 };
+};
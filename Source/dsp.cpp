@@ -10,58 +10,1743 @@
 
 #include "dsp.h"
 
+namespace
+{
+    template <typename SampleType>
+    using SIMDType = juce::dsp::SIMDRegister<SampleType>;
+    
+    // AudioBlock channel pointers carry no alignment guarantee, so the kernels load and store unaligned
+    template <typename SampleType>
+    inline SIMDType<SampleType> loadUnaligned(const SampleType* source) noexcept
+    {
+        SIMDType<SampleType> result;
+        std::memcpy(&result.value, source, sizeof(result.value));
+        return result;
+    }
+    
+    template <typename SampleType>
+    inline void storeUnaligned(SampleType* destination, SIMDType<SampleType> source) noexcept
+    {
+        std::memcpy(destination, &source.value, sizeof(source.value));
+    }
+    
+    template <typename SampleType>
+    inline SIMDType<SampleType> select(typename SIMDType<SampleType>::vMaskType mask,
+                                       SIMDType<SampleType> ifTrue,
+                                       SIMDType<SampleType> ifFalse) noexcept
+    {
+        return (ifTrue & mask) + (ifFalse & ~mask);
+    }
+    
+    // There are no vector transcendentals in juce::dsp, so those lanes are evaluated one at a time
+    template <typename SampleType, typename Function>
+    inline SIMDType<SampleType> applyPerLane(SIMDType<SampleType> x, Function&& function) noexcept
+    {
+        for (size_t i = 0; i < SIMDType<SampleType>::SIMDNumElements; ++i)
+            x.set(i, function(x.get(i)));
+        
+        return x;
+    }
+    
+    template <bool IsRamping, typename SampleType>
+    inline SIMDType<SampleType> loadParameter(const SampleType* parameter, size_t index) noexcept
+    {
+        if constexpr (IsRamping)
+            return loadUnaligned(parameter + index);
+        else
+            return SIMDType<SampleType>::expand(*parameter);
+    }
+    
+    // ln(cosh(x)) without overflowing for large |x|
+    inline double logCosh(double x) noexcept
+    {
+        const auto magnitude = std::abs(x);
+        return magnitude + std::log1p(std::exp(-2.0 * magnitude)) - std::log(2.0);
+    }
+    
+    // The integral of tanh(sinh(t)) from 0 to x has no closed form. It is tabulated once per process for
+    // x in [-range, 0] and read back with cubic Hermite interpolation, using the integrand as the slope.
+    // Past -range the integrand is -1 to double precision, so the integral continues as a straight line.
+    class SaturationIntegral
+    {
+    public:
+        SaturationIntegral()
+        {
+            constexpr int subdivisions = 8;
+            const auto h = 1.0 / (pointsPerUnit * subdivisions);
+            
+            values[0] = 0.0;
+            slopes[0] = integrand(0.0);
+            
+            for (int i = 1; i < numPoints; ++i)
+            {
+                // Simpson's rule from -(i - 1) / pointsPerUnit down to -i / pointsPerUnit
+                const auto start = -(i - 1) / static_cast<double>(pointsPerUnit);
+                auto sum = integrand(start) + integrand(start - subdivisions * h);
+                
+                for (int k = 1; k < subdivisions; ++k)
+                    sum += (k % 2 == 1 ? 4.0 : 2.0) * integrand(start - k * h);
+                
+                values[i] = values[i - 1] - sum * h / 3.0;
+                slopes[i] = integrand(start - subdivisions * h);
+            }
+        }
+        
+        double operator() (double x) const noexcept
+        {
+            jassert (x <= 0.0);
+            
+            const auto position = -x * pointsPerUnit;
+            
+            if (position >= numPoints - 1)
+                return values[numPoints - 1] - (x + range);
+            
+            const auto index = static_cast<int>(position);
+            const auto t  = position - index;
+            const auto t2 = t * t;
+            const auto t3 = t2 * t;
+            const auto step = -1.0 / pointsPerUnit;
+            
+            return (2.0 * t3 - 3.0 * t2 + 1.0) * values[index]
+                 + (t3 - 2.0 * t2 + t) * step * slopes[index]
+                 + (-2.0 * t3 + 3.0 * t2) * values[index + 1]
+                 + (t3 - t2) * step * slopes[index + 1];
+        }
+    
+    private:
+        static double integrand(double t) noexcept { return std::tanh(std::sinh(t)); }
+        
+        static constexpr double range = 8.0;
+        static constexpr int pointsPerUnit = 64;
+        static constexpr int numPoints = static_cast<int>(range) * pointsPerUnit + 1;
+        
+        std::array<double, numPoints> values;
+        std::array<double, numPoints> slopes;
+    };
+    
+    const SaturationIntegral& getSaturationIntegral()
+    {
+        static const SaturationIntegral integral;
+        return integral;
+    }
+    
+    //==============================================================================
+    // One shaper per Mode. Each mirrors the waveshaping part of its scalar process* reference function,
+    // taking the undriven input and the linear drive for that sample.
+    
+    template <typename SampleType>
+    struct FullWaveRectifier
+    {
+        SampleType operator() (SampleType x, SampleType drive) const noexcept { return std::abs(x * drive); }
+        SIMDType<SampleType> operator() (SIMDType<SampleType> x, SIMDType<SampleType> drive) const noexcept
+        {
+            return SIMDType<SampleType>::abs(x * drive);
+        }
+    };
+    
+    template <typename SampleType>
+    struct HalfWaveRectifier
+    {
+        SampleType operator() (SampleType x, SampleType drive) const noexcept { return juce::jmax(SampleType(0), x * drive); }
+        SIMDType<SampleType> operator() (SIMDType<SampleType> x, SIMDType<SampleType> drive) const noexcept
+        {
+            return SIMDType<SampleType>::max(x * drive, SIMDType<SampleType>::expand(0));
+        }
+    };
+    
+    template <typename SampleType>
+    struct HardClipper
+    {
+        static constexpr bool hasSecondAntiderivative = true;
+        static constexpr double limit = 0.99;
+        
+        SampleType operator() (SampleType x, SampleType drive) const noexcept
+        {
+            return juce::jlimit(SampleType(-0.99), SampleType(0.99), x * drive);
+        }
+        
+        double shape(double x) const noexcept { return juce::jlimit(-limit, limit, x); }
+        
+        double antiderivative1(double x) const noexcept
+        {
+            const auto magnitude = std::abs(x);
+            return magnitude <= limit ? 0.5 * x * x : limit * magnitude - 0.5 * limit * limit;
+        }
+        
+        double antiderivative2(double x) const noexcept
+        {
+            const auto magnitude = std::abs(x);
+            const auto value = magnitude <= limit ? magnitude * magnitude * magnitude / 6.0
+                                                  : 0.5 * limit * magnitude * (magnitude - limit) + limit * limit * limit / 6.0;
+            return x < 0 ? -value : value;
+        }
+        
+        SIMDType<SampleType> operator() (SIMDType<SampleType> x, SIMDType<SampleType> drive) const noexcept
+        {
+            return SIMDType<SampleType>::min(SIMDType<SampleType>::max(x * drive, SIMDType<SampleType>::expand(SampleType(-0.99))),
+                                             SIMDType<SampleType>::expand(SampleType(0.99)));
+        }
+    };
+    
+    template <typename SampleType>
+    struct SoftClipper1
+    {
+        SampleType operator() (SampleType x, SampleType drive) const noexcept
+        {
+            x *= drive;
+            const auto magnitude = std::abs(x);
+            
+            if (magnitude < SampleType(0.33))
+                return x * 2;
+            
+            if (magnitude < SampleType(0.67))
+            {
+                const auto knee = 2 - 3 * x;
+                return (3 - knee * knee) / 3;
+            }
+            
+            return 1;
+        }
+        
+        SIMDType<SampleType> operator() (SIMDType<SampleType> x, SIMDType<SampleType> drive) const noexcept
+        {
+            using SIMD = SIMDType<SampleType>;
+            
+            x *= drive;
+            const auto magnitude = SIMD::abs(x);
+            const auto knee = SIMD::expand(2) - x * SIMD::expand(3);
+            const auto curve = (SIMD::expand(3) - knee * knee) * SIMD::expand(SampleType(1) / 3);
+            
+            return select(SIMD::lessThan(magnitude, SIMD::expand(SampleType(0.33))), x * SIMD::expand(2),
+                          select(SIMD::lessThan(magnitude, SIMD::expand(SampleType(0.67))), curve, SIMD::expand(1)));
+        }
+    };
+    
+    template <typename SampleType>
+    struct ArctangentClipper
+    {
+        SampleType scale;
+        
+        SampleType operator() (SampleType x, SampleType drive) const noexcept { return scale * std::atan(x * drive); }
+        SIMDType<SampleType> operator() (SIMDType<SampleType> x, SIMDType<SampleType> drive) const noexcept
+        {
+            return applyPerLane(x * drive, [] (SampleType lane) { return std::atan(lane); }) * SIMDType<SampleType>::expand(scale);
+        }
+        
+        static constexpr bool hasSecondAntiderivative = true;
+        
+        double shape(double x) const noexcept { return scale * std::atan(x); }
+        
+        double antiderivative1(double x) const noexcept
+        {
+            return scale * (x * std::atan(x) - 0.5 * std::log1p(x * x));
+        }
+        
+        double antiderivative2(double x) const noexcept
+        {
+            return scale * (0.5 * (x * x - 1.0) * std::atan(x) + 0.5 * x - 0.5 * x * std::log1p(x * x));
+        }
+    };
+    
+    template <typename SampleType>
+    struct TanhClipper
+    {
+        SampleType scale;
+        
+        SampleType operator() (SampleType x, SampleType drive) const noexcept { return scale * std::tanh(x * drive); }
+        SIMDType<SampleType> operator() (SIMDType<SampleType> x, SIMDType<SampleType> drive) const noexcept
+        {
+            return applyPerLane(x * drive, [] (SampleType lane) { return std::tanh(lane); }) * SIMDType<SampleType>::expand(scale);
+        }
+        
+        static constexpr bool hasSecondAntiderivative = false;
+        
+        double shape(double x) const noexcept { return scale * std::tanh(x); }
+        double antiderivative1(double x) const noexcept { return scale * logCosh(x); }
+    };
+    
+    template <typename SampleType>
+    struct Saturator
+    {
+        template <typename FloatType>
+        static FloatType shape(FloatType x) noexcept
+        {
+            if (x >= 0)
+                return std::tanh(x);
+            
+            return std::tanh(std::sinh(x)) - FloatType(0.2) * x * std::sin(juce::MathConstants<FloatType>::pi * x);
+        }
+        
+        SampleType operator() (SampleType x, SampleType drive) const noexcept { return shape(x * drive); }
+        SIMDType<SampleType> operator() (SIMDType<SampleType> x, SIMDType<SampleType> drive) const noexcept
+        {
+            return applyPerLane(x * drive, shape<SampleType>);
+        }
+        
+        static constexpr bool hasSecondAntiderivative = false;
+        
+        double antiderivative1(double x) const noexcept
+        {
+            if (x >= 0)
+                return logCosh(x);
+            
+            // The sine term integrates in closed form, the tanh(sinh) term comes from the shared table
+            constexpr auto pi = juce::MathConstants<double>::pi;
+            return getSaturationIntegral()(x) - 0.2 * (std::sin(pi * x) / (pi * pi) - x * std::cos(pi * x) / pi);
+        }
+    };
+    
+    // The same curves through the fastmath approximations, which take scalars and registers alike
+    template <typename SampleType, fastmath::Tier T>
+    struct ApproximateArctangentClipper
+    {
+        SampleType scale;
+        
+        template <typename Type>
+        Type operator() (Type x, Type drive) const noexcept { return fastmath::atan<T>(x * drive) * scale; }
+    };
+    
+    template <typename SampleType, fastmath::Tier T>
+    struct ApproximateTanhClipper
+    {
+        SampleType scale;
+        
+        template <typename Type>
+        Type operator() (Type x, Type drive) const noexcept { return fastmath::tanh<T>(x * drive) * scale; }
+    };
+    
+    template <typename SampleType, fastmath::Tier T>
+    struct ApproximateSaturator
+    {
+        template <typename Type>
+        static Type shapeNegative(Type x) noexcept
+        {
+            return fastmath::tanh<T>(fastmath::sinh<T>(x)) - x * fastmath::sinPi<T>(x) * SampleType(0.2);
+        }
+        
+        SampleType operator() (SampleType x, SampleType drive) const noexcept
+        {
+            x *= drive;
+            return x >= 0 ? fastmath::tanh<T>(x) : shapeNegative(x);
+        }
+        
+        SIMDType<SampleType> operator() (SIMDType<SampleType> x, SIMDType<SampleType> drive) const noexcept
+        {
+            using SIMD = SIMDType<SampleType>;
+            
+            x *= drive;
+            return select(SIMD::lessThan(x, SIMD::expand(0)), shapeNegative(x), fastmath::tanh<T>(x));
+        }
+    };
+    
+    // The Bit mode's quantiser. Like a converter it clips at full scale, then rounds to the nearest
+    // of steps levels each side of zero; stepSize is 1 / steps, so no division is left per sample.
+    template <typename SampleType>
+    struct Quantiser
+    {
+        SampleType steps, stepSize;
+        
+        SampleType scale(SampleType x) const noexcept { return juce::jlimit(SampleType(-1), SampleType(1), x) * steps; }
+        SIMDType<SampleType> scale(SIMDType<SampleType> x) const noexcept
+        {
+            using SIMD = SIMDType<SampleType>;
+            return SIMD::min(SIMD::max(x, SIMD::expand(-1)), SIMD::expand(1)) * SIMD::expand(steps);
+        }
+        
+        // Dither can push a full-scale sample one step past the top, which clips like the input does
+        SampleType round(SampleType scaled) const noexcept
+        {
+            return juce::jlimit(SampleType(-1), SampleType(1), std::round(scaled) * stepSize);
+        }
+        
+        SIMDType<SampleType> round(SIMDType<SampleType> scaled) const noexcept
+        {
+            using SIMD = SIMDType<SampleType>;
+            
+            // std::round semantics: halves go away from zero
+            const auto rounded = SIMD::truncate(SIMD::abs(scaled) + SIMD::expand(SampleType(0.5)));
+            const auto signedRounded = select(SIMD::lessThan(scaled, SIMD::expand(0)), SIMD::expand(0) - rounded, rounded);
+            
+            return SIMD::min(SIMD::max(signedRounded * SIMD::expand(stepSize), SIMD::expand(-1)), SIMD::expand(1));
+        }
+        
+        SampleType quantise(SampleType x) const noexcept { return round(scale(x)); }
+    };
+    
+    // TPDF dither in steps, from one xorshift32 generator per lane. The lanes don't depend on each
+    // other, so the compiler vectorises the update, and the two halves of each draw make the two
+    // uniform variables the triangular distribution is the difference of.
+    template <typename SampleType, size_t NumLanes>
+    void fillDither(std::array<juce::uint32, NumLanes>& states, SampleType* destination, size_t numSamples) noexcept
+    {
+        constexpr auto scale = SampleType(1) / 65536;
+        std::array<juce::uint32, NumLanes> draws;
+        
+        for (size_t start = 0; start < numSamples; start += NumLanes)
+        {
+            for (size_t lane = 0; lane < NumLanes; ++lane)
+            {
+                auto state = states[lane];
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                states[lane] = state;
+                draws[lane] = state;
+            }
+            
+            const auto length = juce::jmin(NumLanes, numSamples - start);
+            
+            for (size_t lane = 0; lane < length; ++lane)
+                destination[start + lane] = (static_cast<SampleType>(draws[lane] & 0xffff) - static_cast<SampleType>(draws[lane] >> 16)) * scale;
+        }
+    }
+    
+    template <typename SampleType, bool IsCubic>
+    struct TableShaper
+    {
+        const WaveshaperTable& table;
+        
+        SampleType lookup(SampleType x) const noexcept
+        {
+            if constexpr (IsCubic)
+                return table.processCubic(x);
+            else
+                return table.processLinear(x);
+        }
+        
+        SampleType operator() (SampleType x, SampleType drive) const noexcept { return lookup(x * drive); }
+        SIMDType<SampleType> operator() (SIMDType<SampleType> x, SIMDType<SampleType> drive) const noexcept
+        {
+            return applyPerLane(x * drive, [this] (SampleType lane) { return lookup(lane); });
+        }
+    };
+    
+    //==============================================================================
+    // The shaper each memoryless kernel runs, shared by the per-channel and the stereo kernels
+    template <typename SampleType, typename Distortion<SampleType>::Mode M>
+    auto makeShaper(SampleType piDivisor) noexcept
+    {
+        using Mode = typename Distortion<SampleType>::Mode;
+        
+        static_assert (M != Mode::kBitCrush, "The Bit mode has its own kernel");
+        
+        if constexpr (M == Mode::kFullWave)
+            return FullWaveRectifier<SampleType>();
+        else if constexpr (M == Mode::kHalfWave)
+            return HalfWaveRectifier<SampleType>();
+        else if constexpr (M == Mode::kHard)
+            return HardClipper<SampleType>();
+        else if constexpr (M == Mode::kSoft1)
+            return SoftClipper1<SampleType>();
+        else if constexpr (M == Mode::kSoft2)
+            return ArctangentClipper<SampleType> { piDivisor };
+        else if constexpr (M == Mode::kSoft3)
+            return TanhClipper<SampleType> { piDivisor };
+        else
+            return Saturator<SampleType>();
+    }
+    
+    template <typename SampleType, typename Distortion<SampleType>::Mode M, bool IsCubic>
+    auto makeTableShaper(const std::array<std::shared_ptr<const WaveshaperTable>, 4>& tables) noexcept
+    {
+        using Mode = typename Distortion<SampleType>::Mode;
+        
+        constexpr auto curve = M == Mode::kSoft1 ? WaveshaperTable::Curve::kSoft1
+                             : M == Mode::kSoft2 ? WaveshaperTable::Curve::kSoft2
+                             : M == Mode::kSoft3 ? WaveshaperTable::Curve::kSoft3
+                                                 : WaveshaperTable::Curve::kSaturation;
+        
+        static_assert (M == Mode::kSoft1 || M == Mode::kSoft2 || M == Mode::kSoft3 || M == Mode::kSaturation,
+                       "Only the curved modes have lookup tables");
+        
+        return TableShaper<SampleType, IsCubic> { *tables[static_cast<size_t>(curve)] };
+    }
+    
+    template <typename SampleType, typename Distortion<SampleType>::Mode M, fastmath::Tier T>
+    auto makeApproximateShaper(SampleType piDivisor) noexcept
+    {
+        using Mode = typename Distortion<SampleType>::Mode;
+        
+        static_assert (M == Mode::kSoft2 || M == Mode::kSoft3 || M == Mode::kSaturation,
+                       "Only the transcendental curves have approximations");
+        
+        if constexpr (M == Mode::kSoft2)
+            return ApproximateArctangentClipper<SampleType, T> { piDivisor };
+        else if constexpr (M == Mode::kSoft3)
+            return ApproximateTanhClipper<SampleType, T> { piDivisor };
+        else
+            return ApproximateSaturator<SampleType, T>();
+    }
+    
+    //==============================================================================
+    template <bool IsRamping, bool IsWetOnly, typename SampleType, typename Shaper>
+    void processKernel(const SampleType* input, SampleType* output, size_t numSamples,
+                       const SampleType* drive, const SampleType* mix, const SampleType* outputGain,
+                       const Shaper& shaper) noexcept
+    {
+        using SIMD = SIMDType<SampleType>;
+        constexpr auto width = SIMD::SIMDNumElements;
+        
+        const auto vectorisedSamples = numSamples - numSamples % width;
+        const auto one = SIMD::expand(1);
+        
+        size_t i = 0;
+        
+        for (; i < vectorisedSamples; i += width)
+        {
+            const auto x = loadUnaligned(input + i);
+            const auto wet = shaper(x, loadParameter<IsRamping>(drive, i));
+            
+            if constexpr (IsWetOnly)
+            {
+                storeUnaligned(output + i, wet * loadParameter<IsRamping>(outputGain, i));
+            }
+            else
+            {
+                const auto wetMix = loadParameter<IsRamping>(mix, i);
+                storeUnaligned(output + i, (x * (one - wetMix) + wet * wetMix) * loadParameter<IsRamping>(outputGain, i));
+            }
+        }
+        
+        for (; i < numSamples; ++i)
+        {
+            const auto index = IsRamping ? i : 0;
+            const auto x = input[i];
+            const auto wet = shaper(x, drive[index]);
+            
+            if constexpr (IsWetOnly)
+                output[i] = wet * outputGain[index];
+            else
+                output[i] = ((1 - mix[index]) * x + wet * mix[index]) * outputGain[index];
+        }
+    }
+    
+    template <typename SampleType, typename Shaper>
+    void dispatchKernel(bool isRamping, bool isWetOnly, const SampleType* input, SampleType* output, size_t numSamples,
+                        const SampleType* drive, const SampleType* mix, const SampleType* outputGain, const Shaper& shaper) noexcept
+    {
+        if (isRamping)
+        {
+            if (isWetOnly) processKernel<true, true>  (input, output, numSamples, drive, mix, outputGain, shaper);
+            else           processKernel<true, false> (input, output, numSamples, drive, mix, outputGain, shaper);
+        }
+        else
+        {
+            if (isWetOnly) processKernel<false, true>  (input, output, numSamples, drive, mix, outputGain, shaper);
+            else           processKernel<false, false> (input, output, numSamples, drive, mix, outputGain, shaper);
+        }
+    }
+    
+    // Drive and mix for both halves of a stereo pair (the side ones are only read in mid/side) and
+    // the output gain they share
+    template <typename SampleType>
+    struct StereoParameters
+    {
+        const SampleType* drive;
+        const SampleType* mix;
+        const SampleType* sideDrive;
+        const SampleType* sideMix;
+        const SampleType* outputGain;
+    };
+    
+    // SIMDRegister has no division, so it goes lane by lane
+    template <typename SampleType>
+    inline SIMDType<SampleType> divide(SIMDType<SampleType> numerator, SIMDType<SampleType> denominator) noexcept
+    {
+        for (size_t i = 0; i < SIMDType<SampleType>::SIMDNumElements; ++i)
+            numerator.set(i, numerator.get(i) / denominator.get(i));
+        
+        return numerator;
+    }
+    
+    // Mid/side with the encoding and decoding in the same loop as the shaping: mid = (L + R) / 2 and
+    // side = (L - R) / 2 are shaped with their own drive and mix, then L = mid + side and R = mid - side.
+    // Both channels are loaded before either is stored, so it works in place.
+    template <bool IsRamping, bool IsWetOnly, typename SampleType, typename Shaper>
+    void processMidSideKernel(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples,
+                              const StereoParameters<SampleType>& parameters, const Shaper& shaper) noexcept
+    {
+        using SIMD = SIMDType<SampleType>;
+        constexpr auto width = SIMD::SIMDNumElements;
+        
+        const auto vectorisedSamples = numSamples - numSamples % width;
+        const auto one = SIMD::expand(1);
+        const auto half = SIMD::expand(SampleType(0.5));
+        
+        size_t i = 0;
+        
+        for (; i < vectorisedSamples; i += width)
+        {
+            const auto left  = loadUnaligned(inputs[0] + i);
+            const auto right = loadUnaligned(inputs[1] + i);
+            const auto mid  = (left + right) * half;
+            const auto side = (left - right) * half;
+            
+            auto midWet  = shaper(mid,  loadParameter<IsRamping>(parameters.drive, i));
+            auto sideWet = shaper(side, loadParameter<IsRamping>(parameters.sideDrive, i));
+            
+            if constexpr (! IsWetOnly)
+            {
+                const auto midMix  = loadParameter<IsRamping>(parameters.mix, i);
+                const auto sideMix = loadParameter<IsRamping>(parameters.sideMix, i);
+                midWet  = mid  * (one - midMix)  + midWet  * midMix;
+                sideWet = side * (one - sideMix) + sideWet * sideMix;
+            }
+            
+            const auto outputGain = loadParameter<IsRamping>(parameters.outputGain, i);
+            storeUnaligned(outputs[0] + i, (midWet + sideWet) * outputGain);
+            storeUnaligned(outputs[1] + i, (midWet - sideWet) * outputGain);
+        }
+        
+        for (; i < numSamples; ++i)
+        {
+            const auto index = IsRamping ? i : 0;
+            const auto mid  = (inputs[0][i] + inputs[1][i]) * SampleType(0.5);
+            const auto side = (inputs[0][i] - inputs[1][i]) * SampleType(0.5);
+            
+            auto midWet  = shaper(mid,  parameters.drive[index]);
+            auto sideWet = shaper(side, parameters.sideDrive[index]);
+            
+            if constexpr (! IsWetOnly)
+            {
+                midWet  = (1 - parameters.mix[index])     * mid  + midWet  * parameters.mix[index];
+                sideWet = (1 - parameters.sideMix[index]) * side + sideWet * parameters.sideMix[index];
+            }
+            
+            outputs[0][i] = (midWet + sideWet) * parameters.outputGain[index];
+            outputs[1][i] = (midWet - sideWet) * parameters.outputGain[index];
+        }
+    }
+    
+    // Linked: the louder channel of each sample goes through the shaper and mix, and the gain that
+    // gives it scales both channels. The quieter channel is never larger than the louder one, so
+    // neither output can exceed the shaped sample. Where the louder channel is 0 both are, and any
+    // finite gain will do.
+    template <bool IsRamping, bool IsWetOnly, typename SampleType, typename Shaper>
+    void processLinkedKernel(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples,
+                             const StereoParameters<SampleType>& parameters, const Shaper& shaper) noexcept
+    {
+        using SIMD = SIMDType<SampleType>;
+        constexpr auto width = SIMD::SIMDNumElements;
+        
+        const auto vectorisedSamples = numSamples - numSamples % width;
+        const auto zero = SIMD::expand(0);
+        const auto one = SIMD::expand(1);
+        
+        size_t i = 0;
+        
+        for (; i < vectorisedSamples; i += width)
+        {
+            const auto left  = loadUnaligned(inputs[0] + i);
+            const auto right = loadUnaligned(inputs[1] + i);
+            const auto dominant = select(SIMD::greaterThanOrEqual(SIMD::abs(left), SIMD::abs(right)), left, right);
+            
+            auto wet = shaper(dominant, loadParameter<IsRamping>(parameters.drive, i));
+            
+            if constexpr (! IsWetOnly)
+            {
+                const auto wetMix = loadParameter<IsRamping>(parameters.mix, i);
+                wet = dominant * (one - wetMix) + wet * wetMix;
+            }
+            
+            const auto linkedGain = divide(wet, select(SIMD::equal(dominant, zero), one, dominant))
+                                  * loadParameter<IsRamping>(parameters.outputGain, i);
+            
+            storeUnaligned(outputs[0] + i, left * linkedGain);
+            storeUnaligned(outputs[1] + i, right * linkedGain);
+        }
+        
+        for (; i < numSamples; ++i)
+        {
+            const auto index = IsRamping ? i : 0;
+            const auto left  = inputs[0][i];
+            const auto right = inputs[1][i];
+            const auto dominant = std::abs(left) >= std::abs(right) ? left : right;
+            
+            auto wet = shaper(dominant, parameters.drive[index]);
+            
+            if constexpr (! IsWetOnly)
+                wet = (1 - parameters.mix[index]) * dominant + wet * parameters.mix[index];
+            
+            const auto linkedGain = (dominant != 0 ? wet / dominant : SampleType(0)) * parameters.outputGain[index];
+            outputs[0][i] = left * linkedGain;
+            outputs[1][i] = right * linkedGain;
+        }
+    }
+    
+    template <bool IsMidSide, typename SampleType, typename Shaper>
+    void dispatchStereoKernel(bool isRamping, bool isWetOnly, const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples,
+                              const StereoParameters<SampleType>& parameters, const Shaper& shaper) noexcept
+    {
+        if constexpr (IsMidSide)
+        {
+            if (isRamping)
+            {
+                if (isWetOnly) processMidSideKernel<true, true>  (inputs, outputs, numSamples, parameters, shaper);
+                else           processMidSideKernel<true, false> (inputs, outputs, numSamples, parameters, shaper);
+            }
+            else
+            {
+                if (isWetOnly) processMidSideKernel<false, true>  (inputs, outputs, numSamples, parameters, shaper);
+                else           processMidSideKernel<false, false> (inputs, outputs, numSamples, parameters, shaper);
+            }
+        }
+        else
+        {
+            if (isRamping)
+            {
+                if (isWetOnly) processLinkedKernel<true, true>  (inputs, outputs, numSamples, parameters, shaper);
+                else           processLinkedKernel<true, false> (inputs, outputs, numSamples, parameters, shaper);
+            }
+            else
+            {
+                if (isWetOnly) processLinkedKernel<false, true>  (inputs, outputs, numSamples, parameters, shaper);
+                else           processLinkedKernel<false, false> (inputs, outputs, numSamples, parameters, shaper);
+            }
+        }
+    }
+    
+    // The Bit mode. The wet path reads wetInput, which is the input after sample and hold (or the
+    // input itself when nothing is held), while the dry path reads the input as it is.
+    template <bool IsRamping, bool IsWetOnly, bool IsDithered, typename SampleType>
+    void processCrusherKernel(const SampleType* input, const SampleType* wetInput, const SampleType* dither, SampleType* output, size_t numSamples,
+                              const SampleType* drive, const SampleType* mix, const SampleType* outputGain,
+                              const Quantiser<SampleType>& quantiser) noexcept
+    {
+        using SIMD = SIMDType<SampleType>;
+        constexpr auto width = SIMD::SIMDNumElements;
+        
+        const auto vectorisedSamples = numSamples - numSamples % width;
+        const auto one = SIMD::expand(1);
+        
+        size_t i = 0;
+        
+        for (; i < vectorisedSamples; i += width)
+        {
+            auto scaled = quantiser.scale(loadUnaligned(wetInput + i) * loadParameter<IsRamping>(drive, i));
+            
+            if constexpr (IsDithered)
+                scaled += loadUnaligned(dither + i);
+            
+            const auto wet = quantiser.round(scaled);
+            
+            if constexpr (IsWetOnly)
+            {
+                storeUnaligned(output + i, wet * loadParameter<IsRamping>(outputGain, i));
+            }
+            else
+            {
+                const auto wetMix = loadParameter<IsRamping>(mix, i);
+                storeUnaligned(output + i, (loadUnaligned(input + i) * (one - wetMix) + wet * wetMix) * loadParameter<IsRamping>(outputGain, i));
+            }
+        }
+        
+        for (; i < numSamples; ++i)
+        {
+            const auto index = IsRamping ? i : 0;
+            auto scaled = quantiser.scale(wetInput[i] * drive[index]);
+            
+            if constexpr (IsDithered)
+                scaled += dither[i];
+            
+            const auto wet = quantiser.round(scaled);
+            
+            if constexpr (IsWetOnly)
+                output[i] = wet * outputGain[index];
+            else
+                output[i] = ((1 - mix[index]) * input[i] + wet * mix[index]) * outputGain[index];
+        }
+    }
+    
+    template <bool IsDithered, typename SampleType>
+    void dispatchCrusherKernel(bool isRamping, bool isWetOnly, const SampleType* input, const SampleType* wetInput, const SampleType* dither,
+                               SampleType* output, size_t numSamples, const SampleType* drive, const SampleType* mix, const SampleType* outputGain,
+                               const Quantiser<SampleType>& quantiser) noexcept
+    {
+        if (isRamping)
+        {
+            if (isWetOnly) processCrusherKernel<true, true, IsDithered>  (input, wetInput, dither, output, numSamples, drive, mix, outputGain, quantiser);
+            else           processCrusherKernel<true, false, IsDithered> (input, wetInput, dither, output, numSamples, drive, mix, outputGain, quantiser);
+        }
+        else
+        {
+            if (isWetOnly) processCrusherKernel<false, true, IsDithered>  (input, wetInput, dither, output, numSamples, drive, mix, outputGain, quantiser);
+            else           processCrusherKernel<false, false, IsDithered> (input, wetInput, dither, output, numSamples, drive, mix, outputGain, quantiser);
+        }
+    }
+    
+    // Antiderivative antialiasing. The recursion runs in double precision because the divided differences
+    // cancel badly in float; where consecutive inputs are too close for that, it falls back to evaluating
+    // the shaper (or its first antiderivative) at the midpoint.
+    template <int Order, bool IsRamping, typename SampleType, typename Shaper>
+    void processAntiderivativeKernel(const SampleType* input, SampleType* output, size_t numSamples,
+                                     const SampleType* drive, const SampleType* mix, const SampleType* outputGain,
+                                     const Shaper& shaper, double x1, double x2) noexcept
+    {
+        constexpr double tolerance = 1.0e-5;
+        
+        auto previousAntiderivative = Order == 1 ? shaper.antiderivative1(x1) : 0.0;
+        auto previousDifference = 0.0;
+        
+        if constexpr (Order == 2)
+        {
+            previousAntiderivative = shaper.antiderivative2(x1);
+            previousDifference = std::abs(x1 - x2) < tolerance ? shaper.antiderivative1(0.5 * (x1 + x2))
+                                                               : (previousAntiderivative - shaper.antiderivative2(x2)) / (x1 - x2);
+        }
+        
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const auto index = IsRamping ? i : 0;
+            const double x0 = input[i] * drive[index];
+            double wet;
+            
+            if constexpr (Order == 1)
+            {
+                const auto antiderivative = shaper.antiderivative1(x0);
+                const auto delta = x0 - x1;
+                
+                wet = std::abs(delta) < tolerance ? shaper.shape(0.5 * (x0 + x1))
+                                                  : (antiderivative - previousAntiderivative) / delta;
+                
+                previousAntiderivative = antiderivative;
+            }
+            else
+            {
+                const auto antiderivative = shaper.antiderivative2(x0);
+                const auto difference = std::abs(x0 - x1) < tolerance ? shaper.antiderivative1(0.5 * (x0 + x1))
+                                                                      : (antiderivative - previousAntiderivative) / (x0 - x1);
+                const auto delta = x0 - x2;
+                
+                if (std::abs(delta) >= tolerance)
+                {
+                    wet = 2.0 * (difference - previousDifference) / delta;
+                }
+                else
+                {
+                    const auto midpoint = 0.5 * (x0 + x2);
+                    const auto spread = midpoint - x1;
+                    
+                    wet = std::abs(spread) < tolerance
+                        ? shaper.shape(0.5 * (midpoint + x1))
+                        : 2.0 / spread * (shaper.antiderivative1(midpoint) + (previousAntiderivative - shaper.antiderivative2(midpoint)) / spread);
+                }
+                
+                previousAntiderivative = antiderivative;
+                previousDifference = difference;
+            }
+            
+            x2 = x1;
+            x1 = x0;
+            
+            output[i] = ((1 - mix[index]) * input[i] + static_cast<SampleType>(wet) * mix[index]) * outputGain[index];
+        }
+    }
+}
+
+template <typename SampleType>
+Distortion<SampleType>::Distortion()
+{
+    activeKernel = getKernel(activeMode, activeAntialiasing, activeWaveshaper, activePrecision);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setGain(SampleType newGain)
+{
+    gain.setTargetValue(newGain);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setMix(SampleType newMix)
+{
+    mix.setTargetValue(newMix);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setOutput(SampleType newOutput)
+{
+    output.setTargetValue(newOutput);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setMode(Mode newMode)
+{
+    mode = newMode;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setAntialiasing(Antialiasing newAntialiasing)
+{
+    antialiasing = newAntialiasing;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setWaveshaper(Mode modeToChange, Waveshaper newWaveshaper)
+{
+    waveshapers[static_cast<size_t>(modeToChange)] = newWaveshaper;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setPrecision(Precision newPrecision)
+{
+    precision = newPrecision;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setBitDepth(SampleType newBitDepth)
+{
+    bitDepth = juce::jlimit(SampleType(1), SampleType(24), newBitDepth);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setCrushRate(SampleType newRate)
+{
+    crushRate = juce::jmax(SampleType(0), newRate);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setDither(bool shouldDither)
+{
+    isDithered = shouldDither;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setStereoMode(StereoMode newStereoMode)
+{
+    stereoMode = newStereoMode;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setSideGain(SampleType newGain)
+{
+    sideGain.setTargetValue(newGain);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setSideMix(SampleType newMix)
+{
+    sideMix.setTargetValue(newMix);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setMorphMode(Mode newMode)
+{
+    morphMode = newMode;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setMorph(SampleType newMorph)
+{
+    morph.setTargetValue(juce::jlimit(SampleType(0), SampleType(1), newMorph));
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setControlInterval(size_t numSamples)
+{
+    controlInterval = juce::jmax(static_cast<size_t>(1), numSamples);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setDriveModulation(const SampleType* offsetDecibels, size_t numOffsets, size_t samplesPerOffset) noexcept
+{
+    if (offsetDecibels == nullptr || numOffsets == 0)
+    {
+        // Drops straight back to the plain drive; callers fade the offsets to 0 first to avoid a step
+        driveModulation = nullptr;
+        currentModulation = 0;
+        return;
+    }
+    
+    driveModulation = offsetDecibels;
+    numModulationOffsets = numOffsets;
+    modulationInterval = juce::jmax(static_cast<size_t>(1), samplesPerOffset);
+    modulationPosition = 0;
+    modulationStart = currentModulation;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::prepare(juce::dsp::ProcessSpec& spec)
+{
+    crossfadeBuffer.allocate(spec.maximumBlockSize, true);
+    morphBuffer.allocate(spec.maximumBlockSize, true);
+    
+    parameterBuffer.setSize(kNumParameterChannels, static_cast<int>(spec.maximumBlockSize));
+    
+    numStates = spec.numChannels;
+    antiderivativeStates.allocate(numStates, true);
+    heldSamples.allocate(numStates, true);
+    
+    // Builds or picks up the shared tables now rather than on the audio thread
+    getSaturationIntegral();
+    
+    for (size_t curve = 0; curve < tables.size(); ++curve)
+        tables[curve] = WaveshaperTable::getShared(static_cast<WaveshaperTable::Curve>(curve));
+    
+    setSampleRate(spec.sampleRate);
+    reset();
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::setSampleRate(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    
+    crossfadeLength = static_cast<size_t>(newSampleRate * crossfadeTimeSeconds);
+    crossfadeRemaining = juce::jmin(crossfadeRemaining, crossfadeLength);
+    
+    gain.reset(sampleRate, 0.02);
+    mix.reset(sampleRate, 0.02);
+    output.reset(sampleRate, 0.02);
+    sideGain.reset(sampleRate, 0.02);
+    sideMix.reset(sampleRate, 0.02);
+    morph.reset(sampleRate, 0.02);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::reset() {
+    if (sampleRate > 0)
+    {
+        gain.reset(sampleRate, 0.02);
+        gain.setTargetValue(0.0);
+        
+        mix.reset(sampleRate, 0.02);
+        mix.setTargetValue(1.0);
+        
+        output.reset(sampleRate, 0.02);
+        output.setTargetValue(0.0);
+        
+        sideGain.reset(sampleRate, 0.02);
+        sideGain.setTargetValue(0.0);
+        
+        sideMix.reset(sampleRate, 0.02);
+        sideMix.setTargetValue(1.0);
+        
+        morph.reset(sampleRate, 0.02);
+        morph.setTargetValue(0.0);
+    }
+    
+    activeMode = mode;
+    activeAntialiasing = antialiasing;
+    activeWaveshaper = waveshapers[static_cast<size_t>(mode)];
+    activePrecision = precision;
+    activeKernel = getKernel(activeMode, activeAntialiasing, activeWaveshaper, activePrecision);
+    activeMorphMode = morphMode;
+    activeMorphWaveshaper = waveshapers[static_cast<size_t>(morphMode)];
+    activeMorphKernel = getKernel(activeMorphMode, activeAntialiasing, activeMorphWaveshaper, activePrecision);
+    crossfadeRemaining = 0;
+    
+    activeStereoMode = stereoMode;
+    activeStereoKernel = getStereoKernel(activeStereoMode, activeMode, activeAntialiasing, activeWaveshaper, activePrecision);
+    stereoKernelSource = activeKernel;
+    
+    driveModulation = nullptr;
+    currentModulation = 0;
+    
+    for (size_t channel = 0; channel < numStates; ++channel)
+    {
+        antiderivativeStates[channel] = {};
+        heldSamples[channel] = 0;
+    }
+    
+    // The first block after a reset takes a new sample straight away
+    holdPhase = 1.0;
+    
+    // Fixed seeds keep renders repeatable; xorshift only needs them to be non-zero
+    for (size_t lane = 0; lane < ditherStates.size(); ++lane)
+        ditherStates[lane] = 0x9e3779b9u * static_cast<juce::uint32>(lane + 1);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::processChannel(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept
+{
+    jassert (channel < numStates);
+    
+    // The kernels read the history from before this block, and may overwrite the input in place
+    const auto nextState = getNextState(channel,
+                                        numSamples > 0 ? inputSamples[numSamples - 1] : SampleType(0),
+                                        numSamples > 1 ? inputSamples[numSamples - 2] : SampleType(0),
+                                        numSamples);
+    
+    processChannelWithKernels(channel, inputSamples, outputSamples, numSamples);
+    antiderivativeStates[channel] = nextState;
+}
+
+template <typename SampleType>
+typename Distortion<SampleType>::AntiderivativeState Distortion<SampleType>::getNextState(size_t channel, SampleType last, SampleType beforeLast,
+                                                                                          size_t numSamples) const noexcept
+{
+    auto state = antiderivativeStates[channel];
+    
+    if (numSamples == 0)
+        return state;
+    
+    const auto* drive = getDrive(channel);
+    const auto index = numSamples - 1;
+    
+    state.x2 = numSamples > 1 ? beforeLast * drive[isRamping ? index - 1 : 0] : state.x1;
+    state.x1 = last * drive[isRamping ? index : 0];
+    return state;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::processChannelWithKernels(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept
+{
+    // A fully dry mix only needs the output gain, whatever the mode
+    if (isDry(channel))
+    {
+        const auto* outputGain = isRamping ? parameterBuffer.getReadPointer(kOutputChannel) : &outputValue;
+        
+        for (size_t i = 0; i < numSamples; ++i)
+            outputSamples[i] = inputSamples[i] * outputGain[isRamping ? i : 0];
+        
+        return;
+    }
+    
+    if (crossfadeRemaining == 0)
+    {
+        processMorphedKernels(activeKernel, activeMorphKernel, channel, inputSamples, outputSamples, numSamples);
+        return;
+    }
+    
+    const auto fadeSamples = juce::jmin(numSamples, crossfadeRemaining);
+    
+    // Both sets can hold the bit crusher, whose held sample and dither carry on from call to call,
+    // so the incoming set starts from the same state as the outgoing one instead of from after it
+    const auto heldSample = heldSamples[channel];
+    const auto ditherState = ditherStates;
+    
+    // The outgoing kernels have to read the input before an in-place incoming kernel overwrites it
+    processMorphedKernels(fadingKernel, fadingMorphKernel, channel, inputSamples, crossfadeBuffer.get(), fadeSamples);
+    
+    heldSamples[channel] = heldSample;
+    ditherStates = ditherState;
+    
+    processMorphedKernels(activeKernel, activeMorphKernel, channel, inputSamples, outputSamples, numSamples);
+    
+    const auto step = SampleType(1) / static_cast<SampleType>(crossfadeLength);
+    auto position = static_cast<SampleType>(crossfadeLength - crossfadeRemaining) * step;
+    
+    for (size_t i = 0; i < fadeSamples; ++i)
+    {
+        position += step;
+        outputSamples[i] = crossfadeBuffer[i] + position * (outputSamples[i] - crossfadeBuffer[i]);
+    }
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::processMorphedKernels(Kernel kernel, Kernel morphKernel, size_t channel, const SampleType* inputSamples,
+                                                   SampleType* outputSamples, size_t numSamples) noexcept
+{
+    // The kernels apply the same mix and output gain, so blending their outputs blends the shaped signals
+    if (kernel == morphKernel || (! isMorphMoving && morphValue == 0))
+    {
+        (this->*kernel)(channel, inputSamples, outputSamples, numSamples);
+        return;
+    }
+    
+    if (! isMorphMoving && morphValue == 1)
+    {
+        (this->*morphKernel)(channel, inputSamples, outputSamples, numSamples);
+        return;
+    }
+    
+    (this->*morphKernel)(channel, inputSamples, morphBuffer.get(), numSamples);
+    (this->*kernel)(channel, inputSamples, outputSamples, numSamples);
+    
+    const auto* amount = getParameter(kMorphChannel, morphValue);
+    
+    for (size_t i = 0; i < numSamples; ++i)
+        outputSamples[i] += amount[isRamping ? i : 0] * (morphBuffer[i] - outputSamples[i]);
+}
+
 template <typename SampleType>
-Distortion<SampleType>::Distortion()
+template <typename Distortion<SampleType>::Mode M>
+void Distortion<SampleType>::processWithMode(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept
+{
+    dispatchKernel(isRamping, isWetOnly(channel), inputSamples, outputSamples, numSamples,
+                   getDrive(channel),
+                   getMix(channel),
+                   getParameter(kOutputChannel, outputValue),
+                   makeShaper<SampleType, M>(piDivisor));
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::processBitCrush(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept
 {
+    const auto* wetInput = inputSamples;
+    
+    // Holding carries a value from one sample to the next, so this part stays scalar; it's one select per sample
+    if (isHolding)
+    {
+        const auto* hold = parameterBuffer.getReadPointer(kHoldChannel);
+        auto* held = parameterBuffer.getWritePointer(kHeldChannel);
+        auto value = heldSamples[channel];
+        
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            value = hold[i] != 0 ? inputSamples[i] : value;
+            held[i] = value;
+        }
+        
+        heldSamples[channel] = value;
+        wetInput = held;
+    }
+    
+    const Quantiser<SampleType> quantiser { crushSteps, crushStepSize };
+    const auto* drive      = getDrive(channel);
+    const auto* wetMix     = getMix(channel);
+    const auto* outputGain = getParameter(kOutputChannel, outputValue);
     
+    if (isDithered)
+    {
+        auto* dither = parameterBuffer.getWritePointer(kDitherChannel);
+        fillDither(ditherStates, dither, numSamples);
+        
+        dispatchCrusherKernel<true>(isRamping, isWetOnly(channel), inputSamples, wetInput, dither, outputSamples, numSamples,
+                                    drive, wetMix, outputGain, quantiser);
+    }
+    else
+    {
+        dispatchCrusherKernel<false>(isRamping, isWetOnly(channel), inputSamples, wetInput, static_cast<const SampleType*>(nullptr), outputSamples, numSamples,
+                                     drive, wetMix, outputGain, quantiser);
+    }
 }
 
 template <typename SampleType>
-void Distortion<SampleType>::setGain(SampleType newGain)
+template <typename Distortion<SampleType>::Mode M, int Order>
+void Distortion<SampleType>::processWithAntiderivative(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept
 {
-    gain.setTargetValue(newGain);
+    const auto& state = antiderivativeStates[channel];
+    
+    const auto run = [&] (const auto& shaper)
+    {
+        const auto* drive      = getDrive(channel);
+        const auto* wetMix     = getMix(channel);
+        const auto* outputGain = getParameter(kOutputChannel, outputValue);
+        
+        if (isRamping)
+            processAntiderivativeKernel<Order, true>(inputSamples, outputSamples, numSamples, drive, wetMix, outputGain, shaper, state.x1, state.x2);
+        else
+            processAntiderivativeKernel<Order, false>(inputSamples, outputSamples, numSamples, drive, wetMix, outputGain, shaper, state.x1, state.x2);
+    };
+    
+    if constexpr (M == Mode::kHard)
+        run(HardClipper<SampleType>());
+    else if constexpr (M == Mode::kSoft2)
+        run(ArctangentClipper<SampleType> { piDivisor });
+    else if constexpr (M == Mode::kSoft3)
+        run(TanhClipper<SampleType> { piDivisor });
+    else if constexpr (M == Mode::kSaturation)
+        run(Saturator<SampleType>());
 }
 
 template <typename SampleType>
-void Distortion<SampleType>::setMix(SampleType newMix)
+template <typename Distortion<SampleType>::Mode M, bool IsCubic>
+void Distortion<SampleType>::processWithTable(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept
 {
-    mix.setTargetValue(newMix);
+    dispatchKernel(isRamping, isWetOnly(channel), inputSamples, outputSamples, numSamples,
+                   getDrive(channel),
+                   getMix(channel),
+                   getParameter(kOutputChannel, outputValue),
+                   makeTableShaper<SampleType, M, IsCubic>(tables));
 }
 
 template <typename SampleType>
-void Distortion<SampleType>::setOutput(SampleType newOutput)
+template <typename Distortion<SampleType>::Mode M, fastmath::Tier T>
+void Distortion<SampleType>::processWithApproximation(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept
 {
-    output.setTargetValue(newOutput);
+    dispatchKernel(isRamping, isWetOnly(channel), inputSamples, outputSamples, numSamples,
+                   getDrive(channel),
+                   getMix(channel),
+                   getParameter(kOutputChannel, outputValue),
+                   makeApproximateShaper<SampleType, M, T>(piDivisor));
 }
 
 template <typename SampleType>
-void Distortion<SampleType>::setMode(Mode newMode)
+template <typename Distortion<SampleType>::StereoMode S, typename Shaper>
+void Distortion<SampleType>::processStereoWithShaper(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples, const Shaper& shaper) noexcept
 {
-    mode = newMode;
+    const StereoParameters<SampleType> parameters { getDrive(0), getMix(0), getDrive(1), getMix(1), getParameter(kOutputChannel, outputValue) };
+    
+    dispatchStereoKernel<S == StereoMode::kMidSide>(isRamping, isWetOnly(0) && isWetOnly(1), inputs, outputs, numSamples, parameters, shaper);
 }
 
 template <typename SampleType>
-void Distortion<SampleType>::prepare(juce::dsp::ProcessSpec& spec)
+template <typename Distortion<SampleType>::StereoMode S, typename Distortion<SampleType>::Mode M>
+void Distortion<SampleType>::processStereoWithMode(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples) noexcept
 {
-    sampleRate = spec.sampleRate;
-    reset();
+    processStereoWithShaper<S>(inputs, outputs, numSamples, makeShaper<SampleType, M>(piDivisor));
 }
 
 template <typename SampleType>
-void Distortion<SampleType>::reset() {
-    if (sampleRate > 0)
+template <typename Distortion<SampleType>::StereoMode S, typename Distortion<SampleType>::Mode M, bool IsCubic>
+void Distortion<SampleType>::processStereoWithTable(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples) noexcept
+{
+    processStereoWithShaper<S>(inputs, outputs, numSamples, makeTableShaper<SampleType, M, IsCubic>(tables));
+}
+
+template <typename SampleType>
+template <typename Distortion<SampleType>::StereoMode S, typename Distortion<SampleType>::Mode M, fastmath::Tier T>
+void Distortion<SampleType>::processStereoWithApproximation(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples) noexcept
+{
+    processStereoWithShaper<S>(inputs, outputs, numSamples, makeApproximateShaper<SampleType, M, T>(piDivisor));
+}
+
+template <typename SampleType>
+template <typename Distortion<SampleType>::Mode M>
+typename Distortion<SampleType>::Kernel Distortion<SampleType>::getApproximationKernel(Precision kernelPrecision) noexcept
+{
+    switch (kernelPrecision)
     {
-        gain.reset(sampleRate, 0.02);
-        gain.setTargetValue(0.0);
+        case Precision::kExact:     return &Distortion::processWithMode<M>;
+        case Precision::kHigh:      return &Distortion::processWithApproximation<M, fastmath::Tier::kHigh>;
+        case Precision::kMedium:    return &Distortion::processWithApproximation<M, fastmath::Tier::kMedium>;
+        case Precision::kLow:       return &Distortion::processWithApproximation<M, fastmath::Tier::kLow>;
+    }
+    
+    jassertfalse;
+    return &Distortion::processWithMode<M>;
+}
+
+template <typename SampleType>
+typename Distortion<SampleType>::Kernel Distortion<SampleType>::getKernel(Mode kernelMode, Antialiasing kernelAntialiasing,
+                                                                          Waveshaper kernelWaveshaper, Precision kernelPrecision) noexcept
+{
+    const auto firstOrder  = kernelAntialiasing == Antialiasing::kFirstOrder;
+    const auto secondOrder = kernelAntialiasing == Antialiasing::kSecondOrder;
+    const auto linearTable = kernelWaveshaper == Waveshaper::kLinearTable;
+    const auto cubicTable  = kernelWaveshaper == Waveshaper::kCubicTable;
+    
+    switch (kernelMode)
+    {
+        case Mode::kFullWave:   return &Distortion::processWithMode<Mode::kFullWave>;
+        case Mode::kHalfWave:   return &Distortion::processWithMode<Mode::kHalfWave>;
+        case Mode::kHard:
+        {
+            return firstOrder  ? &Distortion::processWithAntiderivative<Mode::kHard, 1>
+                 : secondOrder ? &Distortion::processWithAntiderivative<Mode::kHard, 2>
+                               : &Distortion::processWithMode<Mode::kHard>;
+        }
+        case Mode::kSoft1:
+        {
+            return linearTable ? &Distortion::processWithTable<Mode::kSoft1, false>
+                 : cubicTable  ? &Distortion::processWithTable<Mode::kSoft1, true>
+                               : &Distortion::processWithMode<Mode::kSoft1>;
+        }
+        case Mode::kSoft2:
+        {
+            return firstOrder  ? &Distortion::processWithAntiderivative<Mode::kSoft2, 1>
+                 : secondOrder ? &Distortion::processWithAntiderivative<Mode::kSoft2, 2>
+                 : linearTable ? &Distortion::processWithTable<Mode::kSoft2, false>
+                 : cubicTable  ? &Distortion::processWithTable<Mode::kSoft2, true>
+                               : getApproximationKernel<Mode::kSoft2>(kernelPrecision);
+        }
+        case Mode::kSoft3:
+        {
+            return firstOrder || secondOrder ? &Distortion::processWithAntiderivative<Mode::kSoft3, 1>
+                 : linearTable               ? &Distortion::processWithTable<Mode::kSoft3, false>
+                 : cubicTable                ? &Distortion::processWithTable<Mode::kSoft3, true>
+                                             : getApproximationKernel<Mode::kSoft3>(kernelPrecision);
+        }
+        case Mode::kSaturation:
+        {
+            return firstOrder || secondOrder ? &Distortion::processWithAntiderivative<Mode::kSaturation, 1>
+                 : linearTable               ? &Distortion::processWithTable<Mode::kSaturation, false>
+                 : cubicTable                ? &Distortion::processWithTable<Mode::kSaturation, true>
+                                             : getApproximationKernel<Mode::kSaturation>(kernelPrecision);
+        }
+        case Mode::kBitCrush:   return &Distortion::processBitCrush;
+    }
+    
+    jassertfalse;
+    return &Distortion::processWithMode<Mode::kHard>;
+}
+
+template <typename SampleType>
+template <typename Distortion<SampleType>::StereoMode S, typename Distortion<SampleType>::Mode M>
+typename Distortion<SampleType>::StereoKernel Distortion<SampleType>::getStereoApproximationKernel(Precision kernelPrecision) noexcept
+{
+    switch (kernelPrecision)
+    {
+        case Precision::kExact:     return &Distortion::processStereoWithMode<S, M>;
+        case Precision::kHigh:      return &Distortion::processStereoWithApproximation<S, M, fastmath::Tier::kHigh>;
+        case Precision::kMedium:    return &Distortion::processStereoWithApproximation<S, M, fastmath::Tier::kMedium>;
+        case Precision::kLow:       return &Distortion::processStereoWithApproximation<S, M, fastmath::Tier::kLow>;
+    }
+    
+    jassertfalse;
+    return &Distortion::processStereoWithMode<S, M>;
+}
+
+template <typename SampleType>
+template <typename Distortion<SampleType>::StereoMode S>
+typename Distortion<SampleType>::StereoKernel Distortion<SampleType>::selectStereoKernel(Mode kernelMode, Antialiasing kernelAntialiasing,
+                                                                                         Waveshaper kernelWaveshaper, Precision kernelPrecision) noexcept
+{
+    // Mirrors getKernel(), leaving out whatever it would give an antiderivative kernel
+    const auto hasAntiderivative = kernelAntialiasing != Antialiasing::kOff
+                                && (kernelMode == Mode::kHard || kernelMode == Mode::kSoft2 || kernelMode == Mode::kSoft3 || kernelMode == Mode::kSaturation);
+    const auto linearTable = kernelWaveshaper == Waveshaper::kLinearTable;
+    const auto cubicTable  = kernelWaveshaper == Waveshaper::kCubicTable;
+    
+    if (hasAntiderivative)
+        return nullptr;
+    
+    switch (kernelMode)
+    {
+        case Mode::kFullWave:   return &Distortion::processStereoWithMode<S, Mode::kFullWave>;
+        case Mode::kHalfWave:   return &Distortion::processStereoWithMode<S, Mode::kHalfWave>;
+        case Mode::kHard:       return &Distortion::processStereoWithMode<S, Mode::kHard>;
+        case Mode::kSoft1:
+        {
+            return linearTable ? &Distortion::processStereoWithTable<S, Mode::kSoft1, false>
+                 : cubicTable  ? &Distortion::processStereoWithTable<S, Mode::kSoft1, true>
+                               : &Distortion::processStereoWithMode<S, Mode::kSoft1>;
+        }
+        case Mode::kSoft2:
+        {
+            return linearTable ? &Distortion::processStereoWithTable<S, Mode::kSoft2, false>
+                 : cubicTable  ? &Distortion::processStereoWithTable<S, Mode::kSoft2, true>
+                               : getStereoApproximationKernel<S, Mode::kSoft2>(kernelPrecision);
+        }
+        case Mode::kSoft3:
+        {
+            return linearTable ? &Distortion::processStereoWithTable<S, Mode::kSoft3, false>
+                 : cubicTable  ? &Distortion::processStereoWithTable<S, Mode::kSoft3, true>
+                               : getStereoApproximationKernel<S, Mode::kSoft3>(kernelPrecision);
+        }
+        case Mode::kSaturation:
+        {
+            return linearTable ? &Distortion::processStereoWithTable<S, Mode::kSaturation, false>
+                 : cubicTable  ? &Distortion::processStereoWithTable<S, Mode::kSaturation, true>
+                               : getStereoApproximationKernel<S, Mode::kSaturation>(kernelPrecision);
+        }
+        case Mode::kBitCrush:   return nullptr;
+    }
+    
+    return nullptr;
+}
+
+template <typename SampleType>
+typename Distortion<SampleType>::StereoKernel Distortion<SampleType>::getStereoKernel(StereoMode kernelStereoMode, Mode kernelMode, Antialiasing kernelAntialiasing,
+                                                                                      Waveshaper kernelWaveshaper, Precision kernelPrecision) noexcept
+{
+    switch (kernelStereoMode)
+    {
+        case StereoMode::kMidSide:  return selectStereoKernel<StereoMode::kMidSide>(kernelMode, kernelAntialiasing, kernelWaveshaper, kernelPrecision);
+        case StereoMode::kLinked:   return selectStereoKernel<StereoMode::kLinked>(kernelMode, kernelAntialiasing, kernelWaveshaper, kernelPrecision);
+        case StereoMode::kLeftRight: break;
+    }
+    
+    return nullptr;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::processStereo(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples) noexcept
+{
+    const auto isMidSide = activeStereoMode == StereoMode::kMidSide;
+    
+    // The signal each half of the pair is shaped as: mid and side, or the louder channel and nothing
+    auto encode = [&] (size_t channel, size_t index)
+    {
+        const auto left = inputs[0][index], right = inputs[1][index];
         
-        mix.reset(sampleRate, 0.02);
-        mix.setTargetValue(1.0);
+        if (isMidSide)
+            return (channel == 0 ? left + right : left - right) * SampleType(0.5);
         
-        output.reset(sampleRate, 0.02);
-        output.setTargetValue(0.0);
+        return channel == 0 && std::abs(right) > std::abs(left) ? right : left;
+    };
+    
+    if (activeStereoKernel != nullptr && crossfadeRemaining == 0 && ! isMorphAudible())
+    {
+        const auto numShaped = isMidSide ? 2 : 1;
+        std::array<AntiderivativeState, 2> nextStates;
+        
+        for (size_t channel = 0; channel < numShaped; ++channel)
+            nextStates[channel] = getNextState(channel,
+                                               numSamples > 0 ? encode(channel, numSamples - 1) : SampleType(0),
+                                               numSamples > 1 ? encode(channel, numSamples - 2) : SampleType(0),
+                                               numSamples);
+        
+        (this->*activeStereoKernel)(inputs, outputs, numSamples);
+        
+        for (size_t channel = 0; channel < numShaped; ++channel)
+            antiderivativeStates[channel] = nextStates[channel];
+        
+        return;
+    }
+    
+    // Without a fused kernel the pair is encoded, shaped channel by channel and decoded in separate passes
+    if (isMidSide)
+    {
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const auto mid = encode(0, i), side = encode(1, i);
+            outputs[0][i] = mid;
+            outputs[1][i] = side;
+        }
+        
+        processChannel(0, outputs[0], outputs[0], numSamples);
+        processChannel(1, outputs[1], outputs[1], numSamples);
+        
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const auto mid = outputs[0][i], side = outputs[1][i];
+            outputs[0][i] = mid + side;
+            outputs[1][i] = mid - side;
+        }
+        
+        return;
+    }
+    
+    auto* dominant = parameterBuffer.getWritePointer(kDominantChannel);
+    auto* shaped = parameterBuffer.getWritePointer(kShapedChannel);
+    
+    for (size_t i = 0; i < numSamples; ++i)
+        dominant[i] = encode(0, i);
+    
+    processChannel(0, dominant, shaped, numSamples);
+    
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        const auto linkedGain = dominant[i] != 0 ? shaped[i] / dominant[i] : SampleType(0);
+        outputs[0][i] = inputs[0][i] * linkedGain;
+        outputs[1][i] = inputs[1][i] * linkedGain;
+    }
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::updateKernel() noexcept
+{
+    const auto requestedMode = mode;
+    const auto requestedMorphMode = morphMode;
+    const auto requestedAntialiasing = antialiasing;
+    const auto requestedWaveshaper = waveshapers[static_cast<size_t>(requestedMode)];
+    const auto requestedMorphWaveshaper = waveshapers[static_cast<size_t>(requestedMorphMode)];
+    const auto requestedPrecision = precision;
+    
+    if (requestedMode == activeMode && requestedMorphMode == activeMorphMode && requestedAntialiasing == activeAntialiasing
+        && requestedWaveshaper == activeWaveshaper && requestedMorphWaveshaper == activeMorphWaveshaper
+        && requestedPrecision == activePrecision)
+        return;
+    
+    const auto requestedKernel = getKernel(requestedMode, requestedAntialiasing, requestedWaveshaper, requestedPrecision);
+    const auto requestedMorphKernel = getKernel(requestedMorphMode, requestedAntialiasing, requestedMorphWaveshaper, requestedPrecision);
+    
+    activeAntialiasing = requestedAntialiasing;
+    activeWaveshaper = requestedWaveshaper;
+    activeMorphWaveshaper = requestedMorphWaveshaper;
+    activePrecision = requestedPrecision;
+    
+    // Settings the current mode doesn't use (e.g. the precision of Hard clipping) leave the kernel as it is
+    if (requestedKernel == activeKernel && requestedMorphKernel == activeMorphKernel)
+        return;
+    
+    // Nothing of the morph kernel is heard while the morph rests at 0, so it can change without a fade
+    if (requestedKernel == activeKernel && crossfadeRemaining == 0 && ! morph.isSmoothing() && morph.getCurrentValue() == 0)
+    {
+        activeMorphMode = requestedMorphMode;
+        activeMorphKernel = requestedMorphKernel;
+        return;
+    }
+    
+    // A change in the middle of a fade restarts it from the kernels that were fading in
+    fadingMode = activeMode;
+    fadingKernel = activeKernel;
+    fadingMorphMode = activeMorphMode;
+    fadingMorphKernel = activeMorphKernel;
+    activeMode = requestedMode;
+    activeKernel = requestedKernel;
+    activeMorphMode = requestedMorphMode;
+    activeMorphKernel = requestedMorphKernel;
+    crossfadeRemaining = crossfadeLength;
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::updateStereoKernel() noexcept
+{
+    // The fused kernel follows the per-channel one, so it changes at the same moment a crossfade starts
+    if (stereoMode == activeStereoMode && activeKernel == stereoKernelSource)
+        return;
+    
+    activeStereoMode = stereoMode;
+    stereoKernelSource = activeKernel;
+    activeStereoKernel = getStereoKernel(activeStereoMode, activeMode, activeAntialiasing, activeWaveshaper, activePrecision);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::advanceCrossfade(size_t numSamples) noexcept
+{
+    crossfadeRemaining -= juce::jmin(numSamples, crossfadeRemaining);
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::updateParameterBuffers(size_t numSamples) noexcept
+{
+    const auto isFading = crossfadeRemaining > 0;
+    const auto isMorphed = hasMorphKernel();
+    
+    if (activeMode == Mode::kBitCrush || (isFading && fadingMode == Mode::kBitCrush)
+        || (isMorphed && (activeMorphMode == Mode::kBitCrush || (isFading && fadingMorphMode == Mode::kBitCrush))))
+        updateCrusher(numSamples);
+    
+    // The side smoothers only move while something reads them. The morph has nothing to blend while
+    // both snapshots share a kernel, so it just skips ahead.
+    const auto isSideRamping = hasSideParameters && (sideGain.isSmoothing() || sideMix.isSmoothing());
+    isMorphMoving = isMorphed && morph.isSmoothing();
+    
+    if (! isMorphed && morph.isSmoothing())
+        morph.skip(static_cast<int>(numSamples));
+    
+    isRamping = gain.isSmoothing() || mix.isSmoothing() || output.isSmoothing() || isSideRamping || isMorphMoving || driveModulation != nullptr;
+    
+    if (! isRamping)
+    {
+        driveValue     = juce::Decibels::decibelsToGain(gain.getCurrentValue());
+        mixValue       = mix.getCurrentValue();
+        outputValue    = juce::Decibels::decibelsToGain(output.getCurrentValue());
+        sideDriveValue = juce::Decibels::decibelsToGain(sideGain.getCurrentValue());
+        sideMixValue   = sideMix.getCurrentValue();
+        morphValue     = morph.getCurrentValue();
+        return;
+    }
+    
+    if (driveModulation != nullptr)
+    {
+        fillModulatedDrive(numSamples);
+    }
+    else
+    {
+        fillRamp(gain, parameterBuffer.getWritePointer(kDriveChannel), numSamples, true);
+        
+        if (hasSideParameters)
+            fillRamp(sideGain, parameterBuffer.getWritePointer(kSideDriveChannel), numSamples, true);
+    }
+    
+    fillRamp(mix,    parameterBuffer.getWritePointer(kMixChannel),    numSamples, false);
+    fillRamp(output, parameterBuffer.getWritePointer(kOutputChannel), numSamples, true);
+    
+    if (hasSideParameters)
+        fillRamp(sideMix, parameterBuffer.getWritePointer(kSideMixChannel), numSamples, false);
+    
+    if (isMorphed)
+        fillRamp(morph, parameterBuffer.getWritePointer(kMorphChannel), numSamples, false);
+    
+    mixValue = mix.getCurrentValue();
+    sideMixValue = sideMix.getCurrentValue();
+    morphValue = morph.getCurrentValue();
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::updateCrusher(size_t numSamples) noexcept
+{
+    crushSteps = static_cast<SampleType>(std::exp2(bitDepth - 1));
+    crushStepSize = 1 / crushSteps;
+    
+    const auto increment = crushRate > 0 ? static_cast<double>(crushRate) / sampleRate : 1.0;
+    isHolding = increment < 1.0;
+    
+    if (! isHolding)
+    {
+        holdPhase = 1.0;
+        return;
+    }
+    
+    // One phase for every channel, so they all take their samples at the same instants. A
+    // fractional increment spreads the rate over hold lengths either side of the ratio.
+    auto* hold = parameterBuffer.getWritePointer(kHoldChannel);
+    
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        holdPhase += increment;
+        const auto takesSample = holdPhase >= 1.0;
+        holdPhase -= takesSample ? 1.0 : 0.0;
+        hold[i] = takesSample ? SampleType(1) : SampleType(0);
+    }
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::fillRamp(juce::SmoothedValue<SampleType>& smoother, SampleType* destination, size_t numSamples, bool isDecibels) noexcept
+{
+    const auto toLinear = [isDecibels] (SampleType value)
+    {
+        return isDecibels ? juce::Decibels::decibelsToGain(value) : value;
+    };
+    
+    if (! smoother.isSmoothing())
+    {
+        std::fill(destination, destination + numSamples, toLinear(smoother.getCurrentValue()));
+        return;
+    }
+    
+    // Convert only at the control points and interpolate the linear values in between
+    auto previous = toLinear(smoother.getCurrentValue());
+    
+    for (size_t start = 0; start < numSamples; start += controlInterval)
+    {
+        const auto length = juce::jmin(controlInterval, numSamples - start);
+        const auto next = toLinear(smoother.skip(static_cast<int>(length)));
+        const auto step = (next - previous) / static_cast<SampleType>(length);
+        
+        for (size_t i = 0; i < length; ++i)
+            destination[start + i] = previous + step * static_cast<SampleType>(i + 1);
+        
+        previous = next;
+    }
+}
+
+template <typename SampleType>
+void Distortion<SampleType>::fillModulatedDrive(size_t numSamples) noexcept
+{
+    // Like fillRamp(), with the modulation added to the gain in dB at each control point. In
+    // mid/side the side drive follows the same modulation.
+    auto* drive = parameterBuffer.getWritePointer(kDriveChannel);
+    auto* sideDrive = parameterBuffer.getWritePointer(kSideDriveChannel);
+    
+    auto previous = juce::Decibels::decibelsToGain(gain.getCurrentValue() + currentModulation);
+    auto previousSide = juce::Decibels::decibelsToGain(sideGain.getCurrentValue() + currentModulation);
+    
+    auto fillSegment = [] (SampleType* destination, SampleType from, SampleType to, size_t length)
+    {
+        const auto step = (to - from) / static_cast<SampleType>(length);
+        
+        for (size_t i = 0; i < length; ++i)
+            destination[i] = from + step * static_cast<SampleType>(i + 1);
+    };
+    
+    for (size_t start = 0; start < numSamples; start += controlInterval)
+    {
+        const auto length = juce::jmin(controlInterval, numSamples - start);
+        modulationPosition += length;
+        currentModulation = getDriveModulation(modulationPosition);
+        
+        const auto next = juce::Decibels::decibelsToGain(gain.skip(static_cast<int>(length)) + currentModulation);
+        fillSegment(drive + start, previous, next, length);
+        previous = next;
+        
+        if (hasSideParameters)
+        {
+            const auto nextSide = juce::Decibels::decibelsToGain(sideGain.skip(static_cast<int>(length)) + currentModulation);
+            fillSegment(sideDrive + start, previousSide, nextSide, length);
+            previousSide = nextSide;
+        }
     }
 }
 
+template <typename SampleType>
+SampleType Distortion<SampleType>::getDriveModulation(size_t position) const noexcept
+{
+    const auto offset = position / modulationInterval;
+    const auto last = numModulationOffsets - 1;
+    
+    if (offset > last)
+        return driveModulation[last];
+    
+    const auto from = offset == 0 ? modulationStart : driveModulation[offset - 1];
+    const auto fraction = static_cast<SampleType>(position % modulationInterval) / static_cast<SampleType>(modulationInterval);
+    return from + fraction * (driveModulation[offset] - from);
+}
+
 template <typename SampleType>
 SampleType Distortion<SampleType>::processSample(SampleType inputSample) noexcept
 {
@@ -118,7 +1803,8 @@ SampleType Distortion<SampleType>::processFullWaveRectification(SampleType input
         wet *= -1.0;
     }
     
-    auto ratio = (1.0 - mix.getNextValue()) * inputSample + wet * mix.getNextValue();
+    auto wetMix = mix.getNextValue();
+    auto ratio = (1.0 - wetMix) * inputSample + wet * wetMix;
     
     return ratio * juce::Decibels::decibelsToGain(output.getNextValue());
 }
@@ -133,7 +1819,8 @@ SampleType Distortion<SampleType>::processHalfWaveRectification(SampleType input
         wet = 0.0;
     }
     
-    auto ratio = (1.0 - mix.getNextValue()) * inputSample + wet * mix.getNextValue();
+    auto wetMix = mix.getNextValue();
+    auto ratio = (1.0 - wetMix) * inputSample + wet * wetMix;
     
     return ratio * juce::Decibels::decibelsToGain(output.getNextValue());
 }
@@ -148,7 +1835,8 @@ SampleType Distortion<SampleType>::processHardClipping(SampleType inputSample)
         wet *= 0.99 / std::abs(wet);
     }
     
-    auto ratio = (1.0 - mix.getNextValue()) * inputSample + wet * mix.getNextValue();
+    auto wetMix = mix.getNextValue();
+    auto ratio = (1.0 - wetMix) * inputSample + wet * wetMix;
     
     return ratio * juce::Decibels::decibelsToGain(output.getNextValue());
 }
@@ -171,7 +1859,8 @@ SampleType Distortion<SampleType>::processSoftClipping1(SampleType inputSample)
         wet = 1;
     }
     
-    auto ratio = (1.0 - mix.getNextValue()) * inputSample + wet * mix.getNextValue();
+    auto wetMix = mix.getNextValue();
+    auto ratio = (1.0 - wetMix) * inputSample + wet * wetMix;
     
     return ratio * juce::Decibels::decibelsToGain(output.getNextValue());
 }
@@ -183,7 +1872,8 @@ SampleType Distortion<SampleType>::processSoftClipping2(SampleType inputSample)
     
     wet = piDivisor * std::atan(wet);
     
-    auto ratio = (1.0 - mix.getNextValue()) * inputSample + wet * mix.getNextValue();
+    auto wetMix = mix.getNextValue();
+    auto ratio = (1.0 - wetMix) * inputSample + wet * wetMix;
     
     return ratio * juce::Decibels::decibelsToGain(output.getNextValue());
 }
@@ -195,7 +1885,8 @@ SampleType Distortion<SampleType>::processSoftClipping3(SampleType inputSample)
     
     wet = piDivisor * std::tanh(wet);
     
-    auto ratio = (1.0 - mix.getNextValue()) * inputSample + wet * mix.getNextValue();
+    auto wetMix = mix.getNextValue();
+    auto ratio = (1.0 - wetMix) * inputSample + wet * wetMix;
     
     return ratio * juce::Decibels::decibelsToGain(output.getNextValue());
 }
@@ -211,24 +1902,56 @@ SampleType Distortion<SampleType>::processSaturation(SampleType inputSample)
     }
     else
     {
-        wet = std::tanh(std::sinh(wet)) - 0.2 * wet * std::sin(juce::MathConstants<float>::pi * wet);
+        wet = std::tanh(std::sinh(wet)) - 0.2 * wet * std::sin(juce::MathConstants<SampleType>::pi * wet);
     }
     
-    auto ratio = (1.0 - mix.getNextValue()) * inputSample + wet * mix.getNextValue();
+    auto wetMix = mix.getNextValue();
+    auto ratio = (1.0 - wetMix) * inputSample + wet * wetMix;
     
     return ratio * juce::Decibels::decibelsToGain(output.getNextValue());
 }
 
 template <typename SampleType>
-SampleType Distortion<SampleType>::processBitReduction(SampleType inputSample)
+SampleType Distortion<SampleType>::getTransferCurve(Mode curveMode, SampleType gainDecibels, SampleType x, SampleType curveBitDepth) noexcept
 {
-    auto wet = inputSample * juce::Decibels::decibelsToGain(0.0);
+    const auto drive = juce::Decibels::decibelsToGain(gainDecibels);
+    const auto scale = 2 / juce::MathConstants<SampleType>::pi;
     
-    int intervals = 28.0 - gain.getNextValue();
+    switch (curveMode)
+    {
+        case Mode::kFullWave:
+            return FullWaveRectifier<SampleType>()(x, drive);
+        case Mode::kHalfWave:
+            return HalfWaveRectifier<SampleType>()(x, drive);
+        case Mode::kHard:
+            return HardClipper<SampleType>()(x, drive);
+        case Mode::kSoft1:
+            return SoftClipper1<SampleType>()(x, drive);
+        case Mode::kSoft2:
+            return ArctangentClipper<SampleType> { scale }(x, drive);
+        case Mode::kSoft3:
+            return TanhClipper<SampleType> { scale }(x, drive);
+        case Mode::kSaturation:
+            return Saturator<SampleType>()(x, drive);
+        case Mode::kBitCrush:
+        {
+            const auto steps = static_cast<SampleType>(std::exp2(juce::jlimit(SampleType(1), SampleType(24), curveBitDepth) - 1));
+            return Quantiser<SampleType> { steps, 1 / steps }.quantise(x * drive);
+        }
+    }
     
-    wet = std::round(intervals * wet) / intervals;
+    return x;
+}
+
+template <typename SampleType>
+SampleType Distortion<SampleType>::processBitReduction(SampleType inputSample)
+{
+    // Without the sample and hold or the dither, which need the block-wide state of processBitCrush
+    const auto steps = static_cast<SampleType>(std::exp2(bitDepth - 1));
+    auto wet = Quantiser<SampleType> { steps, 1 / steps }.quantise(inputSample * juce::Decibels::decibelsToGain(gain.getNextValue()));
     
-    auto ratio = (1.0 - mix.getNextValue()) * inputSample + wet * mix.getNextValue();
+    auto wetMix = mix.getNextValue();
+    auto ratio = (1.0 - wetMix) * inputSample + wet * wetMix;
     
     return ratio * juce::Decibels::decibelsToGain(output.getNextValue());
 }
@@ -10,6 +10,8 @@
 
 #pragma once
 #include <JuceHeader.h>
+#include "tables.h"
+#include "fastmath.h"
 
 template <typename SampleType>
 class Distortion
@@ -29,6 +31,35 @@ public:
         kBitCrush
     };
     
+    enum class Antialiasing
+    {
+        kOff,
+        kFirstOrder,
+        kSecondOrder
+    };
+    
+    enum class Waveshaper
+    {
+        kExact,
+        kLinearTable,
+        kCubicTable
+    };
+    
+    enum class Precision
+    {
+        kExact,
+        kHigh,
+        kMedium,
+        kLow
+    };
+    
+    enum class StereoMode
+    {
+        kLeftRight,
+        kMidSide,
+        kLinked
+    };
+    
     void setGain(SampleType newGain);
     
     void setMix(SampleType newMix);
@@ -37,8 +68,67 @@ public:
     
     void setMode(Mode newMode);
     
+    /** Selects antiderivative antialiasing (ADAA) for the Hard, Soft2, Soft3 and Saturation modes.
+        The second antiderivatives of Soft3 and Saturation aren't elementary, so those stay first order. */
+    void setAntialiasing(Antialiasing newAntialiasing);
+    
+    /** Chooses whether a mode evaluates its curve exactly or reads it from the shared lookup tables.
+        Only the curved modes (Soft1, Soft2, Soft3 and Saturation) have tables, and ADAA always uses the exact curve. */
+    void setWaveshaper(Mode modeToChange, Waveshaper newWaveshaper);
+    
+    /** Chooses how Soft2, Soft3 and Saturation evaluate their exact curves: through the standard library,
+        or through one of the fastmath approximation tiers (see fastmath.h for their error bounds).
+        A cheap tier suits live monitoring, kExact suits offline renders. Tables and ADAA are unaffected. */
+    void setPrecision(Precision newPrecision);
+    
+    /** Sets the word length the Bit mode quantises to, in bits. Fractional depths give step counts in
+        between, so the control sweeps smoothly instead of jumping an octave of steps at a time. */
+    void setBitDepth(SampleType newBitDepth);
+    
+    /** Sets the rate in Hz the Bit mode samples and holds its input at, which needn't divide the
+        processing rate. 0, or anything at or above the processing rate, holds nothing. */
+    void setCrushRate(SampleType newRate);
+    
+    /** Adds triangular (TPDF) dither of one step peak ahead of the Bit mode's quantiser. */
+    void setDither(bool shouldDither);
+    
+    /** Chooses how a stereo pair is shaped. kLeftRight shapes each channel on its own. kMidSide shapes
+        the mid with the gain and mix and the side with setSideGain() and setSideMix(). kLinked applies
+        the gain the louder channel gets at each sample to both, so the image doesn't move. Blocks with
+        any other number of channels are always left/right, and a change isn't crossfaded. */
+    void setStereoMode(StereoMode newStereoMode);
+    
+    /** The drive of the side signal in kMidSide, in dB. */
+    void setSideGain(SampleType newGain);
+    
+    /** The mix of the side signal in kMidSide. */
+    void setSideMix(SampleType newMix);
+    
+    /** The mode of the second snapshot setMorph() blends towards. It gets the same antialiasing,
+        waveshaper and precision settings as the main mode. */
+    void setMorphMode(Mode newMode);
+    
+    /** Blends the shaped signal from the main mode (0) to the morph mode (1). Both kernels only run
+        while the two modes differ and the morph is between the ends; otherwise it costs one. */
+    void setMorph(SampleType newMorph);
+    
+    /** Sets how many samples pass between parameter updates while a value is ramping.
+        The linear gains are interpolated in between, so 1 gives exact per-sample smoothing. */
+    void setControlInterval(size_t numSamples);
+    
+    /** Moves the drive by a modulation signal, e.g. from an EnvelopeFollower, for the process() calls
+        up to the next call of this: offsetDecibels[i] is added to the drive after the first
+        (i + 1) * samplesPerOffset samples, and the drive moves linearly in between. Past the last of
+        the numOffsets values it stays there. The array isn't copied and must outlive those calls.
+        nullptr removes the modulation. */
+    void setDriveModulation(const SampleType* offsetDecibels, size_t numOffsets, size_t samplesPerOffset) noexcept;
+    
     void prepare(juce::dsp::ProcessSpec& spec);
     
+    /** Changes the rate the parameters are smoothed at without touching their targets, e.g. when the
+        oversampling factor changes. Doesn't allocate, so it is safe to call from the audio thread. */
+    void setSampleRate(double newSampleRate);
+    
     void reset();
     
     template <typename ProcessContext>
@@ -48,26 +138,54 @@ public:
         auto& outputBlock      = context.getOutputBlock();
         const auto numChannels = outputBlock.getNumChannels();
         const auto numSamples  = outputBlock.getNumSamples();
-
+        
         jassert (inputBlock.getNumChannels() == numChannels);
         jassert (inputBlock.getNumSamples()  == numSamples);
-
-        for (size_t channel = 0; channel < numChannels; ++channel)
+        
+        jassert (numSamples <= static_cast<size_t>(parameterBuffer.getNumSamples()));
+        
+        updateKernel();
+        updateStereoKernel();
+        
+        const auto isStereo = numChannels == 2 && activeStereoMode != StereoMode::kLeftRight;
+        hasSideParameters = isStereo && activeStereoMode == StereoMode::kMidSide;
+        updateParameterBuffers(numSamples);
+        
+        if (isStereo)
         {
-            auto* inputSamples  = inputBlock .getChannelPointer (channel);
-            auto* outputSamples = outputBlock.getChannelPointer (channel);
-
-            for (size_t i = 0; i < numSamples; ++i)
+            const SampleType* inputs[] { inputBlock.getChannelPointer(0), inputBlock.getChannelPointer(1) };
+            SampleType* outputs[] { outputBlock.getChannelPointer(0), outputBlock.getChannelPointer(1) };
+            
+            processStereo(inputs, outputs, numSamples);
+        }
+        else
+        {
+            for (size_t channel = 0; channel < numChannels; ++channel)
             {
-                outputSamples[i] = processSample(inputSamples[i]);
-            }
+                auto* inputSamples  = inputBlock .getChannelPointer (channel);
+                auto* outputSamples = outputBlock.getChannelPointer (channel);
                 
+                processChannel(channel, inputSamples, outputSamples, numSamples);
+            }
         }
         
+        advanceCrossfade(numSamples);
     }
     
+    /** Runs the vectorised kernel of the current mode over one channel, using the parameters prepared for the current block.
+        While a mode change is fading in, the previous mode's kernel runs alongside and is crossfaded out. */
+    void processChannel(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept;
+    
     SampleType processSample(SampleType inputSample) noexcept;
     
+    static constexpr SampleType defaultBitDepth = 8;
+    
+    /** The static curve of a mode at a given GAIN: the fully wet output for an input x, before the output
+        gain and without antialiasing, dither or sample and hold. Stateless, so the editor can use it to
+        draw the transfer curve. */
+    static SampleType getTransferCurve(Mode curveMode, SampleType gainDecibels, SampleType x,
+                                       SampleType curveBitDepth = defaultBitDepth) noexcept;
+    
     SampleType processFullWaveRectification(SampleType inputSample);
     
     SampleType processHalfWaveRectification(SampleType inputSample);
@@ -83,16 +201,221 @@ public:
     SampleType processSaturation(SampleType inputSample);
     
     SampleType processBitReduction(SampleType inputSample);
-    
+
 private:
-    juce::SmoothedValue<float> gain;
-    juce::SmoothedValue<float> mix;
-    juce::SmoothedValue<float> output;
+    using Kernel = void (Distortion::*)(size_t, const SampleType*, SampleType*, size_t) noexcept;
+    
+    // Takes both channels at once, so mid/side and linked processing make a single pass over them
+    using StereoKernel = void (Distortion::*)(const SampleType* const*, SampleType* const*, size_t) noexcept;
+    
+    template <Mode M>
+    void processWithMode(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept;
+    
+    template <Mode M, int Order>
+    void processWithAntiderivative(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept;
+    
+    template <Mode M, bool IsCubic>
+    void processWithTable(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept;
+    
+    template <Mode M, fastmath::Tier T>
+    void processWithApproximation(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept;
+    
+    void processBitCrush(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept;
+    
+    template <Mode M>
+    static Kernel getApproximationKernel(Precision kernelPrecision) noexcept;
+    
+    static Kernel getKernel(Mode kernelMode, Antialiasing kernelAntialiasing, Waveshaper kernelWaveshaper, Precision kernelPrecision) noexcept;
+    
+    template <StereoMode S, typename Shaper>
+    void processStereoWithShaper(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples, const Shaper& shaper) noexcept;
+    
+    template <StereoMode S, Mode M>
+    void processStereoWithMode(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples) noexcept;
+    
+    template <StereoMode S, Mode M, bool IsCubic>
+    void processStereoWithTable(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples) noexcept;
     
-    float piDivisor = 2.0 / juce::MathConstants<float>::pi;
+    template <StereoMode S, Mode M, fastmath::Tier T>
+    void processStereoWithApproximation(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples) noexcept;
     
-    float sampleRate = 44100.0f;
+    template <StereoMode S, Mode M>
+    static StereoKernel getStereoApproximationKernel(Precision kernelPrecision) noexcept;
+    
+    template <StereoMode S>
+    static StereoKernel selectStereoKernel(Mode kernelMode, Antialiasing kernelAntialiasing, Waveshaper kernelWaveshaper, Precision kernelPrecision) noexcept;
+    
+    /** The fused kernel for a stereo mode and kernel settings, or nullptr where there is none: the
+        antiderivative kernels and the Bit mode keep state per channel, so they go through processChannel(). */
+    static StereoKernel getStereoKernel(StereoMode kernelStereoMode, Mode kernelMode, Antialiasing kernelAntialiasing,
+                                        Waveshaper kernelWaveshaper, Precision kernelPrecision) noexcept;
+    
+    void processStereo(const SampleType* const* inputs, SampleType* const* outputs, size_t numSamples) noexcept;
+    
+    void processChannelWithKernels(size_t channel, const SampleType* inputSamples, SampleType* outputSamples, size_t numSamples) noexcept;
+    
+    /** Runs a kernel and its morph counterpart and blends them by the morph, or just the one that is heard. */
+    void processMorphedKernels(Kernel kernel, Kernel morphKernel, size_t channel, const SampleType* inputSamples,
+                               SampleType* outputSamples, size_t numSamples) noexcept;
+    
+    // True while a morph kernel differs from the kernel it is paired with, now or in a crossfade
+    bool hasMorphKernel() const noexcept
+    {
+        return activeMorphKernel != activeKernel || (crossfadeRemaining > 0 && fadingMorphKernel != fadingKernel);
+    }
+    
+    bool isMorphAudible() const noexcept { return hasMorphKernel() && (isMorphMoving || morphValue > 0); }
+    
+    void updateKernel() noexcept;
+    
+    void updateStereoKernel() noexcept;
+    
+    void advanceCrossfade(size_t numSamples) noexcept;
+    
+    void updateParameterBuffers(size_t numSamples) noexcept;
+    
+    void updateCrusher(size_t numSamples) noexcept;
+    
+    void fillRamp(juce::SmoothedValue<SampleType>& smoother, SampleType* destination, size_t numSamples, bool isDecibels) noexcept;
+    
+    void fillModulatedDrive(size_t numSamples) noexcept;
+    
+    SampleType getDriveModulation(size_t position) const noexcept;
+    
+    const SampleType* getParameter(int channel, const SampleType& value) const noexcept
+    {
+        return isRamping ? parameterBuffer.getReadPointer(channel) : &value;
+    }
+    
+    // In mid/side the second channel is the side, which has its own drive and mix
+    bool usesSideParameters(size_t channel) const noexcept { return hasSideParameters && channel == 1; }
+    
+    const SampleType* getDrive(size_t channel) const noexcept
+    {
+        return usesSideParameters(channel) ? getParameter(kSideDriveChannel, sideDriveValue) : getParameter(kDriveChannel, driveValue);
+    }
+    
+    const SampleType* getMix(size_t channel) const noexcept
+    {
+        return usesSideParameters(channel) ? getParameter(kSideMixChannel, sideMixValue) : getParameter(kMixChannel, mixValue);
+    }
+    
+    bool isWetOnly(size_t channel) const noexcept
+    {
+        return usesSideParameters(channel) ? ! sideMix.isSmoothing() && sideMixValue == 1 : ! mix.isSmoothing() && mixValue == 1;
+    }
+    
+    bool isDry(size_t channel) const noexcept
+    {
+        return usesSideParameters(channel) ? ! sideMix.isSmoothing() && sideMixValue == 0 : ! mix.isSmoothing() && mixValue == 0;
+    }
+    
+    juce::SmoothedValue<SampleType> gain;
+    juce::SmoothedValue<SampleType> mix;
+    juce::SmoothedValue<SampleType> output;
+    juce::SmoothedValue<SampleType> sideGain;
+    juce::SmoothedValue<SampleType> sideMix;
+    juce::SmoothedValue<SampleType> morph;
+    
+    SampleType piDivisor = 2 / juce::MathConstants<SampleType>::pi;
+    
+    double sampleRate = 44100.0;
     Mode mode = Mode::kHard;
     
-    juce::dsp::LinkwitzRileyFilter<float> lpFilter;
+    Antialiasing antialiasing = Antialiasing::kOff;
+    std::array<Waveshaper, 8> waveshapers {};
+    Precision precision = Precision::kExact;
+    
+    Mode activeMode = Mode::kHard;
+    Mode fadingMode = Mode::kHard;
+    Antialiasing activeAntialiasing = Antialiasing::kOff;
+    Waveshaper activeWaveshaper = Waveshaper::kExact;
+    Precision activePrecision = Precision::kExact;
+    Kernel activeKernel = nullptr;
+    Kernel fadingKernel = nullptr;
+    
+    // The second snapshot's mode and its kernels, which crossfade along with the main ones
+    Mode morphMode = Mode::kHard;
+    Mode activeMorphMode = Mode::kHard;
+    Mode fadingMorphMode = Mode::kHard;
+    Waveshaper activeMorphWaveshaper = Waveshaper::kExact;
+    Kernel activeMorphKernel = nullptr;
+    Kernel fadingMorphKernel = nullptr;
+    juce::HeapBlock<SampleType> morphBuffer;
+    
+    StereoMode stereoMode = StereoMode::kLeftRight;
+    StereoMode activeStereoMode = StereoMode::kLeftRight;
+    StereoKernel activeStereoKernel = nullptr;
+    Kernel stereoKernelSource = nullptr;
+    bool hasSideParameters = false;
+    
+    static constexpr double crossfadeTimeSeconds = 0.005;
+    size_t crossfadeLength = 0;
+    size_t crossfadeRemaining = 0;
+    juce::HeapBlock<SampleType> crossfadeBuffer;
+    
+    // Linear drive, mix and output gain for the current block, and the side's drive and mix in
+    // mid/side. When nothing is ramping only the constants are used and the buffers are left
+    // untouched. The Bit mode adds where its sample and hold takes a new sample (shared by all
+    // channels), and scratch space for the held input and the dither of the channel being processed.
+    // Linked processing without a fused kernel keeps the louder channel and its shaped version.
+    // The morph amount gets a ramp while it moves between two different kernels.
+    enum ParameterChannel
+    {
+        kDriveChannel,
+        kMixChannel,
+        kOutputChannel,
+        kSideDriveChannel,
+        kSideMixChannel,
+        kHoldChannel,
+        kHeldChannel,
+        kDitherChannel,
+        kDominantChannel,
+        kShapedChannel,
+        kMorphChannel,
+        kNumParameterChannels
+    };
+    
+    juce::AudioBuffer<SampleType> parameterBuffer;
+    bool isRamping = false;
+    SampleType driveValue = 1, mixValue = 1, outputValue = 1;
+    SampleType sideDriveValue = 1, sideMixValue = 1;
+    SampleType morphValue = 0;
+    bool isMorphMoving = false;
+    size_t controlInterval = 16;
+    
+    // The drive modulation and how far into it the process() calls since it was set have got.
+    // modulationStart is where it was when it was set, so consecutive blocks join up.
+    const SampleType* driveModulation = nullptr;
+    size_t numModulationOffsets = 0, modulationInterval = 1, modulationPosition = 0;
+    SampleType modulationStart = 0, currentModulation = 0;
+    
+    SampleType bitDepth = defaultBitDepth;
+    SampleType crushRate = 0;
+    bool isDithered = false;
+    
+    // Worked out once per block, so the kernel only multiplies and rounds
+    SampleType crushSteps = 128, crushStepSize = SampleType(1) / 128;
+    bool isHolding = false;
+    double holdPhase = 0.0;
+    
+    juce::HeapBlock<SampleType> heldSamples;
+    std::array<juce::uint32, 8> ditherStates {};
+    
+    // The last two driven (pre-shaper) samples of each channel, kept up to date in every mode
+    // so that switching antialiasing on doesn't start from stale history
+    struct AntiderivativeState
+    {
+        SampleType x1 = 0, x2 = 0;
+    };
+    
+    /** The history of a channel after a block ending in beforeLast, last (beforeLast is unused for a
+        single sample). The kernels read the old one, so it is stored once they have run. */
+    AntiderivativeState getNextState(size_t channel, SampleType last, SampleType beforeLast, size_t numSamples) const noexcept;
+    
+    juce::HeapBlock<AntiderivativeState> antiderivativeStates;
+    size_t numStates = 0;
+    
+    // The lookup tables of the curved modes, by WaveshaperTable::Curve, shared with every other instance
+    std::array<std::shared_ptr<const WaveshaperTable>, 4> tables;
 };
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    envelope.cpp
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#include "envelope.h"
+
+template <typename SampleType>
+void EnvelopeFollower<SampleType>::prepare(double newSampleRate, int maximumBlockSize)
+{
+    sampleRate = newSampleRate;
+
+    // Enough for one offset per sample, so setControlInterval() never has to allocate
+    maxOffsets = static_cast<size_t>(juce::jmax(1, maximumBlockSize));
+    offsets.allocate(maxOffsets, true);
+
+    updateCoefficients();
+    depth.reset(sampleRate / controlInterval, 0.05);
+    reset();
+}
+
+template <typename SampleType>
+void EnvelopeFollower<SampleType>::setControlInterval(int numSamples)
+{
+    controlInterval = juce::jmax(1, numSamples);
+    updateCoefficients();
+    
+    // The depth steps once per interval, so its glide has to be re-timed too
+    const auto target = depth.getTargetValue();
+    depth.reset(sampleRate / controlInterval, 0.05);
+    depth.setCurrentAndTargetValue(target);
+}
+
+template <typename SampleType>
+void EnvelopeFollower<SampleType>::setAttack(SampleType milliseconds)
+{
+    attackMilliseconds = milliseconds;
+    updateCoefficients();
+}
+
+template <typename SampleType>
+void EnvelopeFollower<SampleType>::setRelease(SampleType milliseconds)
+{
+    releaseMilliseconds = milliseconds;
+    updateCoefficients();
+}
+
+template <typename SampleType>
+void EnvelopeFollower<SampleType>::setDepth(SampleType decibels)
+{
+    depth.setTargetValue(decibels);
+}
+
+template <typename SampleType>
+void EnvelopeFollower<SampleType>::updateCoefficients()
+{
+    // One-pole coefficients for a step of one control interval
+    auto getCoefficient = [this] (SampleType milliseconds)
+    {
+        const auto timeInIntervals = juce::jmax(1.0e-3, static_cast<double>(milliseconds) * 0.001 * sampleRate / controlInterval);
+        return static_cast<SampleType>(std::exp(-1.0 / timeInIntervals));
+    };
+    
+    attackCoefficient = getCoefficient(attackMilliseconds);
+    releaseCoefficient = getCoefficient(releaseMilliseconds);
+}
+
+template <typename SampleType>
+void EnvelopeFollower<SampleType>::reset()
+{
+    level = 0;
+    depth.setCurrentAndTargetValue(depth.getTargetValue());
+}
+
+template <typename SampleType>
+const SampleType* EnvelopeFollower<SampleType>::process(const juce::AudioBuffer<SampleType>& detector, int numChannels) noexcept
+{
+    const auto numSamples = detector.getNumSamples();
+    numChannels = juce::jmin(numChannels, detector.getNumChannels());
+    numOffsets = 0;
+    
+    for (int start = 0; start < numSamples && numOffsets < maxOffsets; start += controlInterval)
+    {
+        const auto length = juce::jmin(controlInterval, numSamples - start);
+        SampleType peak = 0;
+        
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto range = juce::FloatVectorOperations::findMinAndMax(detector.getReadPointer(channel, start), length);
+            peak = juce::jmax(peak, -range.getStart(), range.getEnd());
+        }
+        
+        // A shorter last interval still steps the smoother by a whole one, which is close enough
+        const auto coefficient = peak > level ? attackCoefficient : releaseCoefficient;
+        level = peak + coefficient * (level - peak);
+        
+        const auto decibels = juce::Decibels::gainToDecibels(level, -rangeDecibels);
+        offsets[numOffsets++] = depth.getNextValue() * (decibels + rangeDecibels) / rangeDecibels;
+    }
+    
+    return offsets.get();
+}
+
+template class EnvelopeFollower<float>;
+template class EnvelopeFollower<double>;
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    envelope.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/** Follows the level of a detector signal at control rate and turns it into drive offsets in dB for
+    Distortion::setDriveModulation().
+
+    Only the peak of each control interval is measured, and it goes through a one-pole attack/release
+    smoother once per interval. The smoothed level is mapped in dB over the bottom rangeDecibels to
+    0..1, which scales the depth: at full scale the drive moves by the whole depth, at -30 dBFS by half.
+*/
+template <typename SampleType>
+class EnvelopeFollower
+{
+public:
+    static constexpr SampleType rangeDecibels = 60;
+    
+    void prepare(double newSampleRate, int maximumBlockSize);
+    
+    /** Sets how many samples share one envelope value. The distortion interpolates in between. */
+    void setControlInterval(int numSamples);
+    
+    int getControlInterval() const noexcept { return controlInterval; }
+    
+    void setAttack(SampleType milliseconds);
+    
+    void setRelease(SampleType milliseconds);
+    
+    /** Sets how far a full-scale detector moves the drive, in dB. Negative depths pull the drive back
+        on loud passages. Changes glide over 50 ms so they don't step the drive. */
+    void setDepth(SampleType decibels);
+    
+    /** False once the depth has settled at 0, when the offsets would all be 0 too. */
+    bool isActive() const noexcept { return depth.isSmoothing() || depth.getTargetValue() != 0; }
+    
+    void reset();
+    
+    /** Measures one block of the detector and returns the drive offset in dB at the end of each of its
+        control intervals, getNumOffsets() of them. The last interval may be shorter than the others. */
+    const SampleType* process(const juce::AudioBuffer<SampleType>& detector, int numChannels) noexcept;
+    
+    size_t getNumOffsets() const noexcept { return numOffsets; }
+
+private:
+    void updateCoefficients();
+    
+    double sampleRate = 44100.0;
+    int controlInterval = 16;
+    
+    SampleType attackMilliseconds = 10, releaseMilliseconds = 150;
+    SampleType attackCoefficient = 0, releaseCoefficient = 0;
+    juce::SmoothedValue<SampleType> depth;
+    
+    SampleType level = 0;
+    
+    juce::HeapBlock<SampleType> offsets;
+    size_t maxOffsets = 0, numOffsets = 0;
+};
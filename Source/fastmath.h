@@ -0,0 +1,312 @@
+/*
+  ==============================================================================
+
+    fastmath.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/** Branch-free approximations of the transcendental functions behind the distortion curves.
+    
+    Every function takes either a plain float/double or a juce::dsp::SIMDRegister of them, so the
+    vectorised kernels can shape a whole register at once instead of calling the standard library
+    one lane at a time.
+    
+    Each function comes in three tiers. The worst-case errors, measured in double precision over
+    the whole valid input range, are:
+                  
+                  kLow        kMedium     kHigh
+        tanh      9.9e-4      5.1e-6      2.5e-8      absolute
+        atan      6.1e-4      1.1e-5      3.7e-8      absolute
+        sinPi     6.8e-5      5.9e-7      3.3e-9      absolute
+        sinh      1.7e-4      3.3e-6      2.4e-9      relative
+    
+    In float, kHigh stays within a few ulp for tanh, atan and sinPi. sinh additionally loses
+    about |x| * 2^-24 of relative precision to the rounding of its exponent. The periodic
+    reduction in sinPi and sin is only valid for |x| < 2^22.
+*/
+namespace fastmath
+{
+    enum class Tier
+    {
+        kLow,
+        kMedium,
+        kHigh
+    };
+    
+    namespace detail
+    {
+        template <typename Type>
+        struct Ops
+        {
+            using Element = Type;
+            
+            static Type expand(double value) noexcept               { return static_cast<Type>(value); }
+            static Type abs(Type x) noexcept                        { return std::abs(x); }
+            static Type min(Type a, Type b) noexcept                { return juce::jmin(a, b); }
+            static Type max(Type a, Type b) noexcept                { return juce::jmax(a, b); }
+            static Type truncate(Type x) noexcept                   { return std::trunc(x); }
+            static Type reciprocal(Type x) noexcept                 { return 1 / x; }
+            
+            /** a < b ? ifLess : ifNotLess */
+            static Type selectLess(Type a, Type b, Type ifLess, Type ifNotLess) noexcept
+            {
+                return a < b ? ifLess : ifNotLess;
+            }
+            
+            /** 2^n for an integer-valued n inside the normal exponent range */
+            static Type pow2(Type n) noexcept
+            {
+                return std::ldexp(Type(1), static_cast<int>(n));
+            }
+        };
+        
+        template <typename ElementType>
+        struct Ops<juce::dsp::SIMDRegister<ElementType>>
+        {
+            using Type = juce::dsp::SIMDRegister<ElementType>;
+            using Element = ElementType;
+            using Bits = typename Type::vMaskType;
+            using BitsElement = typename Type::MaskType;
+            
+            static Type expand(double value) noexcept               { return Type::expand(static_cast<Element>(value)); }
+            static Type abs(Type x) noexcept                        { return Type::abs(x); }
+            static Type min(Type a, Type b) noexcept                { return Type::min(a, b); }
+            static Type max(Type a, Type b) noexcept                { return Type::max(a, b); }
+            static Type truncate(Type x) noexcept                   { return Type::truncate(x); }
+            
+            static Type selectLess(Type a, Type b, Type ifLess, Type ifNotLess) noexcept
+            {
+                const auto mask = Type::lessThan(a, b);
+                return (ifLess & mask) + (ifNotLess & ~mask);
+            }
+            
+            static Bits toBits(Type x) noexcept
+            {
+                Bits result;
+                std::memcpy(&result.value, &x.value, sizeof(result.value));
+                return result;
+            }
+            
+            static Type fromBits(Bits x) noexcept
+            {
+                Type result;
+                std::memcpy(&result.value, &x.value, sizeof(result.value));
+                return result;
+            }
+            
+            /** There is no vector divide in juce::dsp, so this refines an exponent-flipping bit trick
+                with Newton-Raphson steps, each of which squares the relative error. x must be positive. */
+            static Type reciprocal(Type x) noexcept
+            {
+                constexpr auto isFloat = sizeof(Element) == 4;
+                constexpr auto magic = isFloat ? BitsElement(0x7ef311c3) : BitsElement(0x7fde623822fc16e6);
+                constexpr auto numSteps = isFloat ? 3 : 4;
+                
+                auto estimate = fromBits(Bits::expand(magic) - toBits(x));
+                const auto two = expand(2);
+                
+                for (int step = 0; step < numSteps; ++step)
+                    estimate = estimate * (two - x * estimate);
+                
+                return estimate;
+            }
+            
+            static Type pow2(Type n) noexcept
+            {
+                constexpr auto mantissaBits = std::numeric_limits<Element>::digits - 1;
+                constexpr auto bias = std::numeric_limits<Element>::max_exponent - 1;
+                
+                // Adding 2^mantissaBits leaves a small non-negative integer in the low bits of the
+                // representation, which is then moved up into the exponent field
+                const auto shift = expand(static_cast<double>(BitsElement(1) << mantissaBits));
+                const auto biased = toBits(n + expand(bias) + shift) - toBits(shift);
+                
+                return fromBits(biased * Bits::expand(BitsElement(1) << mantissaBits));
+            }
+        };
+        
+        template <typename Type>
+        Type polynomial(Type, double c0) noexcept
+        {
+            return Ops<Type>::expand(c0);
+        }
+        
+        /** c0 + c1 x + c2 x^2 + ..., evaluated with Horner's scheme */
+        template <typename Type, typename... Coefficients>
+        Type polynomial(Type x, double c0, Coefficients... rest) noexcept
+        {
+            return Ops<Type>::expand(c0) + x * polynomial(x, rest...);
+        }
+        
+        template <typename Type>
+        Type copySign(Type magnitude, Type sign) noexcept
+        {
+            using O = Ops<Type>;
+            return O::selectLess(sign, O::expand(0), O::expand(0) - magnitude, magnitude);
+        }
+        
+        template <typename Type>
+        Type floor(Type x) noexcept
+        {
+            using O = Ops<Type>;
+            const auto truncated = O::truncate(x);
+            return O::selectLess(x, truncated, truncated - O::expand(1), truncated);
+        }
+        
+        /** e^x for x >= 0, saturating a little below the largest finite value so that the
+            bit-trick reciprocal still works on the result */
+        template <Tier T, typename Type>
+        Type exp(Type x) noexcept
+        {
+            using O = Ops<Type>;
+            
+            constexpr auto maxExponent = std::numeric_limits<typename O::Element>::max_exponent - 3;
+            
+            const auto t = O::min(x * O::expand(1.4426950408889634), O::expand(maxExponent));
+            const auto n = floor(t + O::expand(0.5));
+            const auto f = t - n;
+            
+            // 2^f on [-0.5, 0.5], minimax in relative error
+            Type fraction;
+            
+            if constexpr (T == Tier::kLow)
+                fraction = polynomial(f, 0.99992807213305869, 0.69326098703504394, 0.24261114590008244, 0.055171671698093204);
+            else if constexpr (T == Tier::kMedium)
+                fraction = polynomial(f, 0.99999926143075412, 0.69312181434319959, 0.24024744848385592, 0.05591786355262433,
+                                      0.0095701022204642463);
+            else
+                fraction = polynomial(f, 1.0000000005541772, 0.69314720573767295, 0.24022646890584973, 0.055503287760807545,
+                                      0.0096184889592518992, 0.0013399931577825112, 0.00015345812269636834);
+            
+            return fraction * O::pow2(n);
+        }
+    }
+    
+    //==============================================================================
+    /** Truncations of Lambert's continued fraction, clamped where they cross the asymptote */
+    template <Tier T, typename Type>
+    Type tanh(Type x) noexcept
+    {
+        using O = detail::Ops<Type>;
+        using detail::polynomial;
+        
+        constexpr auto limit = T == Tier::kLow ? 3.46 : T == Tier::kMedium ? 6.12 : 8.76;
+        
+        x = O::max(O::min(x, O::expand(limit)), O::expand(-limit));
+        const auto y = x * x;
+        
+        Type numerator, denominator;
+        
+        if constexpr (T == Tier::kLow)
+        {
+            numerator   = polynomial(y, 1.0, 0.1111111111111111, 0.0010582010582010583);
+            denominator = polynomial(y, 1.0, 0.4444444444444444, 0.015873015873015872);
+        }
+        else if constexpr (T == Tier::kMedium)
+        {
+            numerator   = polynomial(y, 1.0, 0.13725490196078433, 0.00392156862745098, 2.8729440494146376e-05, 2.901963686277412e-08);
+            denominator = polynomial(y, 1.0, 0.47058823529411764, 0.027450980392156862, 0.00040221216691804925, 1.3058836588248353e-06);
+        }
+        else
+        {
+            numerator   = polynomial(y, 1.0, 0.14666666666666667, 0.0052173913043478265, 6.625258799171843e-05,
+                                     3.2286836253274086e-07, 5.179706350792634e-10, 1.264885555749117e-13);
+            denominator = polynomial(y, 1.0, 0.48, 0.03188405797101449, 0.0006625258799171842,
+                                     5.230467473030402e-06, 1.5193805295658393e-08, 1.1510458557316966e-11);
+        }
+        
+        const auto result = x * numerator * O::reciprocal(denominator);
+        return O::max(O::min(result, O::expand(1)), O::expand(-1));
+    }
+    
+    /** Odd minimax polynomial on [0, 1], with atan(x) = pi/2 - atan(1/x) above that */
+    template <Tier T, typename Type>
+    Type atan(Type x) noexcept
+    {
+        using O = detail::Ops<Type>;
+        using detail::polynomial;
+        
+        const auto one = O::expand(1);
+        const auto magnitude = O::abs(x);
+        const auto reduced = O::min(magnitude, O::reciprocal(O::max(magnitude, one)));
+        const auto y = reduced * reduced;
+        
+        Type result;
+        
+        if constexpr (T == Tier::kLow)
+            result = reduced * polynomial(y, 0.99535791447192426, -0.28869000758923204, 0.079338802689318343);
+        else if constexpr (T == Tier::kMedium)
+            result = reduced * polynomial(y, 0.99986632835931002, -0.33030476624273558, 0.18015920997603,
+                                          -0.085156217983856893, 0.020845046355562679);
+        else
+            result = reduced * polynomial(y, 0.99999933557330435, -0.33329860760919808, 0.1994656535483577, -0.13908627941765654,
+                                          0.096421929303574167, -0.055912263198046409, 0.02186291153797229, -0.0040545538101119618);
+        
+        result = O::selectLess(one, magnitude, O::expand(juce::MathConstants<double>::halfPi) - result, result);
+        return detail::copySign(result, x);
+    }
+    
+    /** sin(pi * x): reduced to [-0.5, 0.5] around the nearest integer, then an odd minimax polynomial */
+    template <Tier T, typename Type>
+    Type sinPi(Type x) noexcept
+    {
+        using O = detail::Ops<Type>;
+        using detail::polynomial;
+        
+        const auto half = O::expand(0.5);
+        const auto nearest = detail::floor(x + half);
+        const auto reduced = x - nearest;
+        const auto y = reduced * reduced;
+        
+        Type result;
+        
+        if constexpr (T == Tier::kLow)
+            result = reduced * polynomial(y, 3.1406400282860592, -5.1369051139759507, 2.2995464325640142);
+        else if constexpr (T == Tier::kMedium)
+            result = reduced * polynomial(y, 3.1415820220411209, -5.1671427917682966, 2.5418989824009403, -0.55463607494639622);
+        else
+            result = reduced * polynomial(y, 3.1415925800440028, -5.1677068788770652, 2.5500313764262211,
+                                          -0.59804516881947335, 0.07722011821721759);
+        
+        // Every odd period flips the sign
+        const auto halfNearest = nearest * half;
+        return O::selectLess(detail::floor(halfNearest), halfNearest, O::expand(0) - result, result);
+    }
+    
+    template <Tier T, typename Type>
+    Type sin(Type x) noexcept
+    {
+        return sinPi<T>(x * detail::Ops<Type>::expand(1.0 / juce::MathConstants<double>::pi));
+    }
+    
+    /** Taylor series below |x| = 1, where (e^x - e^-x) / 2 would cancel, and the exponential above */
+    template <Tier T, typename Type>
+    Type sinh(Type x) noexcept
+    {
+        using O = detail::Ops<Type>;
+        using detail::polynomial;
+        
+        const auto magnitude = O::abs(x);
+        const auto y = magnitude * magnitude;
+        
+        Type series;
+        
+        if constexpr (T == Tier::kLow)
+            series = magnitude * polynomial(y, 1.0, 1.0 / 6.0, 1.0 / 120.0);
+        else if constexpr (T == Tier::kMedium)
+            series = magnitude * polynomial(y, 1.0, 1.0 / 6.0, 1.0 / 120.0, 1.0 / 5040.0);
+        else
+            series = magnitude * polynomial(y, 1.0, 1.0 / 6.0, 1.0 / 120.0, 1.0 / 5040.0, 1.0 / 362880.0, 1.0 / 39916800.0);
+        
+        const auto exponential = detail::exp<T>(magnitude);
+        const auto difference = (exponential - O::reciprocal(exponential)) * O::expand(0.5);
+        
+        return detail::copySign(O::selectLess(magnitude, O::expand(1), series, difference), x);
+    }
+}
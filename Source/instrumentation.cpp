@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    instrumentation.cpp
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#include "instrumentation.h"
+
+#if UD_ENABLE_INSTRUMENTATION
+
+Instrumentation::Instrumentation()
+    : nanosecondsPerTick(1.0e9 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()))
+{
+}
+
+void Instrumentation::beginBlock(int numSamples, double sampleRate) noexcept
+{
+    stageTicks.fill(0);
+    
+    const auto blockSeconds = sampleRate > 0 ? numSamples / sampleRate : 0.0;
+    deadlineTicks = static_cast<juce::int64>(blockSeconds * 1.0e9 / nanosecondsPerTick);
+    
+    blockStart = juce::Time::getHighResolutionTicks();
+}
+
+void Instrumentation::endBlock() noexcept
+{
+    const auto blockTicks = juce::Time::getHighResolutionTicks() - blockStart;
+    stageTicks[static_cast<size_t>(Stage::kBlock)] = blockTicks;
+    
+    // Stages that didn't run this block are filed as zero, so the percentiles are per block
+    for (size_t stage = 0; stage < numStages; ++stage)
+        record(stage, static_cast<juce::uint64>(juce::jmax(juce::int64(0), stageTicks[stage]) * nanosecondsPerTick));
+    
+    if (deadlineTicks > 0 && blockTicks > deadlineTicks)
+        deadlineMisses.store(deadlineMisses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void Instrumentation::record(size_t stage, juce::uint64 nanoseconds) noexcept
+{
+    // Single writer, so a load and a store are enough and no read-modify-write is needed
+    auto& bin = histograms[stage][static_cast<size_t>(getBin(nanoseconds))];
+    bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    
+    if (nanoseconds > maxNanoseconds[stage].load(std::memory_order_relaxed))
+        maxNanoseconds[stage].store(nanoseconds, std::memory_order_relaxed);
+}
+
+int Instrumentation::getBin(juce::uint64 nanoseconds) noexcept
+{
+    if (nanoseconds == 0)
+        return 0;
+    
+    const auto value = static_cast<juce::uint32>(juce::jmin(nanoseconds, juce::uint64(0xffffffff)));
+    const auto octave = juce::findHighestSetBit(value);
+    
+    // The two bits below the leading one pick the quarter of the octave
+    const auto mantissa = octave >= 2 ? value >> (octave - 2) : value << (2 - octave);
+    
+    return octave * binsPerOctave + static_cast<int>(mantissa & 3);
+}
+
+double Instrumentation::getBinUpperEdgeSeconds(int bin) noexcept
+{
+    const auto octave = bin / binsPerOctave;
+    const auto quarter = bin % binsPerOctave;
+    
+    return (5 + quarter) * std::exp2(octave - 2) * 1.0e-9;
+}
+
+Instrumentation::Statistics Instrumentation::getStatistics(Stage stage) const
+{
+    const auto& histogram = histograms[static_cast<size_t>(stage)];
+    
+    std::array<juce::uint32, numBins> counts;
+    juce::uint64 total = 0;
+    
+    for (size_t bin = 0; bin < counts.size(); ++bin)
+    {
+        counts[bin] = histogram[bin].load(std::memory_order_relaxed);
+        total += counts[bin];
+    }
+    
+    Statistics statistics;
+    statistics.numBlocks = total;
+    statistics.maxSeconds = static_cast<double>(maxNanoseconds[static_cast<size_t>(stage)].load(std::memory_order_relaxed)) * 1.0e-9;
+    
+    if (total == 0)
+        return statistics;
+    
+    auto getPercentile = [&] (double fraction)
+    {
+        const auto rank = juce::jmax(juce::uint64(1), static_cast<juce::uint64>(std::ceil(fraction * static_cast<double>(total))));
+        juce::uint64 cumulative = 0;
+        
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            cumulative += counts[static_cast<size_t>(bin)];
+            
+            if (cumulative >= rank)
+                return juce::jmin(getBinUpperEdgeSeconds(bin), statistics.maxSeconds);
+        }
+        
+        return statistics.maxSeconds;
+    };
+    
+    statistics.p50Seconds = getPercentile(0.5);
+    statistics.p90Seconds = getPercentile(0.9);
+    statistics.p99Seconds = getPercentile(0.99);
+    return statistics;
+}
+
+void Instrumentation::reset() noexcept
+{
+    for (auto& histogram : histograms)
+        for (auto& bin : histogram)
+            bin.store(0, std::memory_order_relaxed);
+    
+    for (auto& maximum : maxNanoseconds)
+        maximum.store(0, std::memory_order_relaxed);
+    
+    deadlineMisses.store(0, std::memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    instrumentation.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+// Per-block timing of the processing stages. On by default in debug builds only; define
+// UD_ENABLE_INSTRUMENTATION=1 in the project's preprocessor definitions to measure a release build.
+// When it is off the macros below expand to nothing and no Instrumentation is ever created.
+#ifndef UD_ENABLE_INSTRUMENTATION
+ #if JUCE_DEBUG
+  #define UD_ENABLE_INSTRUMENTATION 1
+ #else
+  #define UD_ENABLE_INSTRUMENTATION 0
+ #endif
+#endif
+
+#if UD_ENABLE_INSTRUMENTATION
+
+/** Collects how long each stage of processBlock takes into fixed-size histograms.
+    
+    The audio thread is the only writer. It adds up the time of each stage over a block and files
+    the totals into the histograms when the block ends. It never locks or allocates, and it only
+    ever stores into relaxed atomics. Any other thread (the editor, a headless tool) can read
+    percentiles and deadline misses at any time. A reading taken while a block is being filed may
+    be one block behind for some stages, which doesn't matter for statistics.
+    
+    The histograms have four bins per octave from 1 ns to about 4 s, so a percentile is reported
+    as the upper edge of its bin, at most 25% above the true value.
+*/
+class Instrumentation
+{
+public:
+    enum class Stage
+    {
+        kOversampling,
+        kDistortion,
+        kCabinet,
+        kToneFilter,
+        kBlock
+    };
+    
+    static constexpr int numStages = 5;
+    
+    struct Statistics
+    {
+        juce::uint64 numBlocks = 0;
+        double p50Seconds = 0, p90Seconds = 0, p99Seconds = 0, maxSeconds = 0;
+    };
+    
+    Instrumentation();
+    
+    /** Starts timing a block that has to finish within numSamples / sampleRate to keep up. */
+    void beginBlock(int numSamples, double sampleRate) noexcept;
+    
+    void endBlock() noexcept;
+    
+    void addStageTime(Stage stage, juce::int64 ticks) noexcept
+    {
+        stageTicks[static_cast<size_t>(stage)] += ticks;
+    }
+    
+    Statistics getStatistics(Stage stage) const;
+    
+    /** The number of blocks that took longer than the audio they produced. */
+    juce::uint64 getDeadlineMisses() const noexcept { return deadlineMisses.load(std::memory_order_relaxed); }
+    
+    /** Clears the histograms. Blocks filed while this runs may be partly kept. */
+    void reset() noexcept;
+    
+    /** Times its scope and adds the result to a stage of the current block. */
+    class ScopedStage
+    {
+    public:
+        ScopedStage(Instrumentation& owner, Stage stageToTime) noexcept
+            : instrumentation(owner), stage(stageToTime), start(juce::Time::getHighResolutionTicks())
+        {
+        }
+        
+        ~ScopedStage()
+        {
+            instrumentation.addStageTime(stage, juce::Time::getHighResolutionTicks() - start);
+        }
+    
+    private:
+        Instrumentation& instrumentation;
+        Stage stage;
+        juce::int64 start;
+        
+        JUCE_DECLARE_NON_COPYABLE(ScopedStage)
+    };
+    
+    /** Brackets a whole block with beginBlock() and endBlock(), whichever way the block returns. */
+    class ScopedBlock
+    {
+    public:
+        ScopedBlock(Instrumentation& owner, int numSamples, double sampleRate) noexcept
+            : instrumentation(owner)
+        {
+            instrumentation.beginBlock(numSamples, sampleRate);
+        }
+        
+        ~ScopedBlock()
+        {
+            instrumentation.endBlock();
+        }
+    
+    private:
+        Instrumentation& instrumentation;
+        
+        JUCE_DECLARE_NON_COPYABLE(ScopedBlock)
+    };
+
+private:
+    static constexpr int binsPerOctave = 4;
+    static constexpr int numBins = 32 * binsPerOctave;
+    
+    static int getBin(juce::uint64 nanoseconds) noexcept;
+    
+    static double getBinUpperEdgeSeconds(int bin) noexcept;
+    
+    void record(size_t stage, juce::uint64 nanoseconds) noexcept;
+    
+    const double nanosecondsPerTick;
+    
+    // Only touched by the audio thread
+    std::array<juce::int64, numStages> stageTicks {};
+    juce::int64 blockStart = 0;
+    juce::int64 deadlineTicks = 0;
+    
+    std::array<std::array<std::atomic<juce::uint32>, numBins>, numStages> histograms {};
+    std::array<std::atomic<juce::uint64>, numStages> maxNanoseconds {};
+    std::atomic<juce::uint64> deadlineMisses { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Instrumentation)
+};
+
+ #define UD_INSTRUMENT_BLOCK(instrumentation, numSamples, sampleRate) \
+    Instrumentation::ScopedBlock instrumentedBlock (instrumentation, numSamples, sampleRate)
+
+ #define UD_INSTRUMENT_STAGE(instrumentation, stage) \
+    Instrumentation::ScopedStage JUCE_JOIN_MACRO (instrumentedStage, __LINE__) (instrumentation, Instrumentation::Stage::stage)
+
+#else
+
+ #define UD_INSTRUMENT_BLOCK(instrumentation, numSamples, sampleRate)
+ #define UD_INSTRUMENT_STAGE(instrumentation, stage)
+
+#endif
@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    metering.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/** Peak and RMS gain of the input and output of one block, for the left and right channel
+    (a mono bus fills both sides with the same values). */
+struct LevelFrame
+{
+    std::array<float, 2> inputPeak {}, inputRms {}, outputPeak {}, outputRms {};
+};
+
+/** Hands LevelFrames from the audio thread to the editor: one producer, one consumer, and
+    wait-free on both sides. When the editor falls behind new frames are dropped, so the audio
+    thread never waits. */
+class LevelFifo
+{
+public:
+    /** Audio thread only. Returns false if the frame was dropped. */
+    bool push(const LevelFrame& frame) noexcept
+    {
+        const auto scope = fifo.write(1);
+        
+        if (scope.blockSize1 == 0)
+            return false;
+        
+        frames[static_cast<size_t>(scope.startIndex1)] = frame;
+        return true;
+    }
+    
+    /** Editor only. Returns false if there was nothing to read. */
+    bool pop(LevelFrame& frame) noexcept
+    {
+        const auto scope = fifo.read(1);
+        
+        if (scope.blockSize1 == 0)
+            return false;
+        
+        frame = frames[static_cast<size_t>(scope.startIndex1)];
+        return true;
+    }
+    
+    template <typename SampleType>
+    static void measure(const juce::AudioBuffer<SampleType>& buffer, int numChannels, std::array<float, 2>& peak, std::array<float, 2>& rms) noexcept
+    {
+        const auto numSamples = buffer.getNumSamples();
+        numChannels = juce::jmin(numChannels, buffer.getNumChannels(), 2);
+        
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            peak[static_cast<size_t>(channel)] = static_cast<float>(buffer.getMagnitude(channel, 0, numSamples));
+            rms[static_cast<size_t>(channel)]  = static_cast<float>(buffer.getRMSLevel(channel, 0, numSamples));
+        }
+        
+        if (numChannels == 1)
+        {
+            peak[1] = peak[0];
+            rms[1] = rms[0];
+        }
+    }
+
+private:
+    static constexpr int capacity = 64;
+    
+    juce::AbstractFifo fifo { capacity };
+    std::array<LevelFrame, capacity> frames;
+};
+
+/** Hands the mono sum of the input and output of every block from the audio thread to the
+    spectrum analyzer, one producer and one consumer. Both sides of a block share a single write
+    so the two streams always stay sample aligned. Samples that don't fit are dropped. */
+class AnalyzerFifo
+{
+public:
+    static constexpr int capacity = 16384;
+    
+    /** Audio thread only: reserves room for the block and writes the input into it. Must be
+        followed by pushOutput() with the processed buffer of the same block. */
+    template <typename SampleType>
+    void pushInput(const juce::AudioBuffer<SampleType>& buffer, int numChannels) noexcept
+    {
+        fifo.prepareToWrite(buffer.getNumSamples(), start1, size1, start2, size2);
+        write(input, buffer, numChannels);
+    }
+    
+    template <typename SampleType>
+    void pushOutput(const juce::AudioBuffer<SampleType>& buffer, int numChannels) noexcept
+    {
+        write(output, buffer, numChannels);
+        fifo.finishedWrite(size1 + size2);
+    }
+    
+    /** Analyzer thread only. Reads up to maxSamples aligned input and output samples and returns
+        how many were read. */
+    int pop(float* inputDestination, float* outputDestination, int maxSamples) noexcept
+    {
+        const auto scope = fifo.read(maxSamples);
+        
+        std::copy_n(input.data() + scope.startIndex1, scope.blockSize1, inputDestination);
+        std::copy_n(input.data() + scope.startIndex2, scope.blockSize2, inputDestination + scope.blockSize1);
+        std::copy_n(output.data() + scope.startIndex1, scope.blockSize1, outputDestination);
+        std::copy_n(output.data() + scope.startIndex2, scope.blockSize2, outputDestination + scope.blockSize1);
+        
+        return scope.blockSize1 + scope.blockSize2;
+    }
+
+private:
+    template <typename SampleType>
+    void write(std::array<float, capacity>& destination, const juce::AudioBuffer<SampleType>& buffer, int numChannels) const noexcept
+    {
+        numChannels = juce::jmin(numChannels, buffer.getNumChannels());
+        
+        if (numChannels <= 0)
+            return;
+        
+        const auto scale = static_cast<SampleType>(1) / static_cast<SampleType>(numChannels);
+        
+        auto writeRange = [&] (int destinationStart, int sourceStart, int numSamples)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                SampleType sum = 0;
+                
+                for (int channel = 0; channel < numChannels; ++channel)
+                    sum += buffer.getReadPointer(channel)[sourceStart + i];
+                
+                destination[static_cast<size_t>(destinationStart + i)] = static_cast<float>(sum * scale);
+            }
+        };
+        
+        writeRange(start1, 0, size1);
+        writeRange(start2, size1, size2);
+    }
+    
+    juce::AbstractFifo fifo { capacity };
+    std::array<float, capacity> input {}, output {};
+    
+    // The region reserved by pushInput(), filled in by pushOutput()
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+};
@@ -0,0 +1,259 @@
+/*
+  ==============================================================================
+
+    meters.cpp
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#include "meters.h"
+
+void LevelMeter::setLevels(const std::array<float, 2>& peak, const std::array<float, 2>& rms)
+{
+    auto hasMoved = false;
+
+    for (size_t channel = 0; channel < 2; ++channel)
+    {
+        const auto newPeak = juce::jmax(juce::Decibels::gainToDecibels(peak[channel], minimumDecibels),
+                                        peakDecibels[channel] - peakFallDecibels);
+        const auto newRms = juce::Decibels::gainToDecibels(rms[channel], minimumDecibels);
+        
+        // Anything under a pixel or so isn't worth a repaint
+        hasMoved = hasMoved || std::abs(newPeak - peakDecibels[channel]) > 0.25f
+                            || std::abs(newRms - rmsDecibels[channel]) > 0.25f;
+        
+        peakDecibels[channel] = newPeak;
+        rmsDecibels[channel] = newRms;
+    }
+    
+    if (hasMoved)
+        repaint();
+}
+
+float LevelMeter::getPosition(float decibels) const noexcept
+{
+    return juce::jmap(decibels, minimumDecibels, 0.0f, static_cast<float>(getHeight()), 0.0f);
+}
+
+void LevelMeter::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().toFloat();
+    const auto barWidth = bounds.getWidth() / 2;
+    
+    g.setColour(juce::Colours::black.withAlpha(0.3f));
+    g.fillRect(bounds);
+    
+    for (size_t channel = 0; channel < 2; ++channel)
+    {
+        auto bar = bounds.removeFromLeft(barWidth).reduced(1.0f, 0.0f);
+        
+        g.setColour(juce::Colours::whitesmoke.withAlpha(0.5f));
+        g.fillRect(bar.withTop(getPosition(rmsDecibels[channel])));
+        
+        g.setColour(peakDecibels[channel] >= 0.0f ? juce::Colours::red : juce::Colours::whitesmoke);
+        g.fillRect(bar.withTop(getPosition(peakDecibels[channel])).withHeight(1.5f));
+    }
+}
+
+void TransferCurve::setCurve(Mode newMode, float newGainDecibels, float newBitDepth)
+{
+    // The bit depth only shapes the Bit mode, so the other modes don't redraw for it
+    const auto bitDepthChanged = newMode == Mode::kBitCrush && newBitDepth != bitDepth;
+    
+    if (hasCurve && newMode == mode && newGainDecibels == gainDecibels && ! bitDepthChanged)
+        return;
+    
+    mode = newMode;
+    gainDecibels = newGainDecibels;
+    bitDepth = newBitDepth;
+    renderCurve();
+    repaint();
+}
+
+void TransferCurve::setInputLevel(float newPeak)
+{
+    newPeak = juce::jlimit(0.0f, 1.0f, newPeak);
+    
+    if (getPoint(newPeak).getDistanceFrom(getPoint(inputPeak)) < 0.5f)
+        return;
+    
+    inputPeak = newPeak;
+    repaint();
+}
+
+juce::Point<float> TransferCurve::getPoint(float input) const noexcept
+{
+    // Both axes span -1 to 1; whatever the curve does outside that is clipped
+    const auto output = juce::jlimit(-1.0f, 1.0f, Distortion<float>::getTransferCurve(mode, gainDecibels, input, bitDepth));
+    
+    return { juce::jmap(input, -1.0f, 1.0f, 0.0f, static_cast<float>(getWidth())),
+             juce::jmap(output, -1.0f, 1.0f, static_cast<float>(getHeight()), 0.0f) };
+}
+
+void TransferCurve::resized()
+{
+    renderCurve();
+}
+
+void TransferCurve::renderCurve()
+{
+    hasCurve = true;
+    
+    if (getWidth() <= 0 || getHeight() <= 0)
+    {
+        curveImage = {};
+        return;
+    }
+    
+    const auto scale = juce::Component::getApproximateScaleFactorForComponent(this);
+    curveImage = juce::Image(juce::Image::ARGB, juce::roundToInt(getWidth() * scale), juce::roundToInt(getHeight() * scale), true);
+    
+    juce::Graphics g (curveImage);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    
+    const auto bounds = getLocalBounds().toFloat();
+    
+    g.setColour(juce::Colours::black.withAlpha(0.3f));
+    g.fillRect(bounds);
+    
+    g.setColour(juce::Colours::whitesmoke.withAlpha(0.2f));
+    g.drawHorizontalLine(getHeight() / 2, 0.0f, bounds.getRight());
+    g.drawVerticalLine(getWidth() / 2, 0.0f, bounds.getBottom());
+    
+    juce::Path curve;
+    const auto numPoints = juce::jmax(2, getWidth());
+    
+    for (int i = 0; i < numPoints; ++i)
+    {
+        const auto point = getPoint(juce::jmap(static_cast<float>(i), 0.0f, static_cast<float>(numPoints - 1), -1.0f, 1.0f));
+        
+        if (i == 0)
+            curve.startNewSubPath(point);
+        else
+            curve.lineTo(point);
+    }
+    
+    g.setColour(juce::Colours::whitesmoke);
+    g.strokePath(curve, juce::PathStrokeType(1.5f));
+}
+
+void TransferCurve::paint(juce::Graphics& g)
+{
+    g.drawImage(curveImage, getLocalBounds().toFloat());
+    
+    if (inputPeak > 0.0f)
+    {
+        const auto marker = getPoint(inputPeak);
+        g.setColour(juce::Colours::orange);
+        g.fillEllipse(juce::Rectangle<float>(5.0f, 5.0f).withCentre(marker));
+    }
+}
+
+SpectrumView::SpectrumView(AnalyzerFifo& fifoToRead)
+    : fifo(fifoToRead)
+{
+}
+
+void SpectrumView::update(double sampleRate)
+{
+    if (analyzer == nullptr && isShowing())
+        analyzer = std::make_unique<SpectrumAnalyzer>(fifo);
+    
+    if (sampleRate <= 0.0 || analyzer == nullptr || ! analyzer->getSpectrum(spectrum))
+        return;
+    
+    currentSampleRate = sampleRate;
+    hasSpectrum = true;
+    updatePaths();
+    repaint();
+}
+
+void SpectrumView::resized()
+{
+    if (hasSpectrum)
+        updatePaths();
+}
+
+void SpectrumView::updatePaths()
+{
+    inputPath = createPath(spectrum.input, false);
+    outputPath = createPath(spectrum.output, false);
+    inharmonicPath = createPath(spectrum.inharmonic, true);
+}
+
+juce::Path SpectrumView::createPath(const std::array<float, SpectrumAnalyzer::numBins>& magnitudes, bool shouldClose) const
+{
+    juce::Path path;
+    const auto width = getWidth();
+    const auto height = static_cast<float>(getHeight());
+    
+    if (width <= 0)
+        return path;
+    
+    const auto binsPerHertz = SpectrumAnalyzer::fftSize / currentSampleRate;
+    const auto octaves = std::log2(currentSampleRate / 2.0 / minimumFrequency);
+    
+    auto getBin = [&] (int x)
+    {
+        const auto frequency = minimumFrequency * std::exp2(octaves * x / width);
+        return juce::jlimit(0, SpectrumAnalyzer::numBins - 1, static_cast<int>(frequency * binsPerHertz));
+    };
+    
+    auto getY = [&] (float decibels)
+    {
+        return juce::jmap(juce::jmax(decibels, minimumDecibels), minimumDecibels, 0.0f, height, 0.0f);
+    };
+    
+    if (shouldClose)
+        path.startNewSubPath(0.0f, height);
+    
+    // Columns at the top end cover many bins and show the loudest of them; columns at the
+    // bottom end cover less than one and repeat it
+    for (int x = 0; x < width; ++x)
+    {
+        const auto firstBin = getBin(x);
+        const auto lastBin = juce::jmax(firstBin, getBin(x + 1) - 1);
+        const auto decibels = *std::max_element(magnitudes.begin() + firstBin, magnitudes.begin() + lastBin + 1);
+        const auto point = juce::Point<float>(static_cast<float>(x), getY(decibels));
+        
+        if (x == 0 && ! shouldClose)
+            path.startNewSubPath(point);
+        else
+            path.lineTo(point);
+    }
+    
+    if (shouldClose)
+    {
+        path.lineTo(static_cast<float>(width), height);
+        path.closeSubPath();
+    }
+    
+    return path;
+}
+
+void SpectrumView::paint(juce::Graphics& g)
+{
+    g.setColour(juce::Colours::black.withAlpha(0.3f));
+    g.fillRect(getLocalBounds().toFloat());
+    
+    if (! hasSpectrum)
+        return;
+    
+    g.setColour(juce::Colours::red.withAlpha(0.6f));
+    g.fillPath(inharmonicPath);
+    
+    g.setColour(juce::Colours::whitesmoke.withAlpha(0.3f));
+    g.strokePath(inputPath, juce::PathStrokeType(1.0f));
+    
+    g.setColour(juce::Colours::whitesmoke);
+    g.strokePath(outputPath, juce::PathStrokeType(1.0f));
+    
+    const auto text = spectrum.fundamentalBin > 0.0f
+                    ? "Inharmonic " + juce::String(spectrum.inharmonicDecibels, 1) + " dB"
+                    : juce::String("Inharmonic -");
+    
+    g.setFont(12.0f);
+    g.drawText(text, getLocalBounds().reduced(4, 2), juce::Justification::topRight);
+}
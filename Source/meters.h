@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    meters.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "dsp.h"
+#include "analyzer.h"
+
+/** A vertical stereo meter: a bar for the RMS level with a line for the peak. The peak falls back
+    at a fixed rate between updates, and the meter only repaints when what it shows has moved. */
+class LevelMeter : public juce::Component
+{
+public:
+    static constexpr float minimumDecibels = -60.0f;
+    
+    /** Takes the gains measured since the last update; call it at the editor's refresh rate. */
+    void setLevels(const std::array<float, 2>& peak, const std::array<float, 2>& rms);
+    
+    void paint(juce::Graphics& g) override;
+
+private:
+    float getPosition(float decibels) const noexcept;
+    
+    std::array<float, 2> peakDecibels { minimumDecibels, minimumDecibels };
+    std::array<float, 2> rmsDecibels { minimumDecibels, minimumDecibels };
+    
+    // How far the peak line falls per update, about 20 dB/s at 30 Hz
+    static constexpr float peakFallDecibels = 0.7f;
+};
+
+/** The transfer curve of the current mode and GAIN, with a marker where the current input peak
+    lands on it. The curve is rendered into a cached image that is only redrawn when the mode, the
+    gain or the size changes; repainting the marker just blits that image. */
+class TransferCurve : public juce::Component
+{
+public:
+    using Mode = Distortion<float>::Mode;
+    
+    void setCurve(Mode newMode, float newGainDecibels, float newBitDepth);
+    
+    void setInputLevel(float newPeak);
+    
+    void paint(juce::Graphics& g) override;
+    
+    void resized() override;
+
+private:
+    void renderCurve();
+    
+    juce::Point<float> getPoint(float input) const noexcept;
+    
+    juce::Image curveImage;
+    Mode mode = Mode::kHard;
+    float gainDecibels = 0.0f;
+    float bitDepth = Distortion<float>::defaultBitDepth;
+    float inputPeak = 0.0f;
+    bool hasCurve = false;
+};
+
+/** Input and output spectra on a log frequency axis, with the inharmonic part of the output
+    filled in red and its total level printed in the corner. It owns the analyzer thread and only
+    starts it once the view is on screen, so the FFT only runs while it can be seen and an editor
+    that is created but never shown doesn't pay for it. */
+class SpectrumView : public juce::Component
+{
+public:
+    static constexpr float minimumFrequency = 20.0f;
+    static constexpr float minimumDecibels = -100.0f;
+    
+    explicit SpectrumView(AnalyzerFifo& fifoToRead);
+    
+    /** Picks up the newest spectrum, if there is one, and repaints. Call it from the editor's timer. */
+    void update(double sampleRate);
+    
+    void paint(juce::Graphics& g) override;
+    
+    void resized() override;
+
+private:
+    void updatePaths();
+    
+    juce::Path createPath(const std::array<float, SpectrumAnalyzer::numBins>& magnitudes, bool shouldClose) const;
+    
+    AnalyzerFifo& fifo;
+    std::unique_ptr<SpectrumAnalyzer> analyzer;
+    SpectrumAnalyzer::Spectrum spectrum;
+    double currentSampleRate = 44100.0;
+    bool hasSpectrum = false;
+    
+    juce::Path inputPath, outputPath, inharmonicPath;
+};
@@ -0,0 +1,230 @@
+/*
+  ==============================================================================
+
+    multiband.cpp
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#include "multiband.h"
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::setNumBands(int newNumBands)
+{
+    newNumBands = juce::jlimit(1, maxBands, newNumBands);
+    
+    if (newNumBands == numBands)
+        return;
+    
+    // The splits that were idle hold stale state, so the whole network starts again from silence
+    numBands = newNumBands;
+    crossovers[activeCrossover].reset();
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::setCrossoverFrequency(int index, SampleType newFrequency)
+{
+    jassert (juce::isPositiveAndBelow(index, maxBands - 1));
+    
+    if (crossoverFrequencies[static_cast<size_t>(index)] == newFrequency)
+        return;
+    
+    crossoverFrequencies[static_cast<size_t>(index)] = newFrequency;
+    updateCrossover();
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::prepare(juce::dsp::ProcessSpec& spec)
+{
+    for (auto& band : bands)
+        band.prepare(spec);
+    
+    numChannels = spec.numChannels;
+    maximumBlockSize = spec.maximumBlockSize;
+    bandBuffer.setSize(static_cast<int>(numChannels) * maxBands, static_cast<int>(juce::jmin(subBlockSize, maximumBlockSize)));
+    
+    for (size_t stages = 0; stages < crossovers.size(); ++stages)
+    {
+        // LinkwitzRileyFilter only takes its rate through prepare()
+        auto crossoverSpec = spec;
+        crossoverSpec.sampleRate = spec.sampleRate * static_cast<double>(1 << stages);
+        
+        for (auto& splitter : crossovers[stages].splitters)
+        {
+            splitter.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
+            splitter.prepare(crossoverSpec);
+        }
+        
+        for (auto& bandCompensation : crossovers[stages].compensation)
+        {
+            for (auto& allpass : bandCompensation)
+            {
+                allpass.setType(juce::dsp::LinkwitzRileyFilterType::allpass);
+                allpass.prepare(crossoverSpec);
+            }
+        }
+    }
+    
+    hostSampleRate = spec.sampleRate;
+    activeCrossover = 0;
+    updateCrossover();
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::setOversamplingStages(int stages)
+{
+    jassert (juce::isPositiveAndNotGreaterThan(stages, maxOversamplingStages));
+    
+    for (auto& band : bands)
+        band.setSampleRate(hostSampleRate * static_cast<double>(1 << stages));
+    
+    const auto newCrossover = static_cast<size_t>(stages);
+    
+    if (newCrossover == activeCrossover)
+        return;
+    
+    // The network that was running holds state for another rate, so the new one starts from silence
+    activeCrossover = newCrossover;
+    crossovers[activeCrossover].reset();
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::setControlInterval(size_t numSamples)
+{
+    for (auto& band : bands)
+        band.setControlInterval(numSamples);
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::setDriveModulation(const SampleType* offsetDecibels, size_t numOffsets, size_t samplesPerOffset) noexcept
+{
+    for (auto& band : bands)
+        band.setDriveModulation(offsetDecibels, numOffsets, samplesPerOffset);
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::reset()
+{
+    for (auto& band : bands)
+        band.reset();
+    
+    crossovers[activeCrossover].reset();
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::Crossover::reset()
+{
+    for (auto& splitter : splitters)
+        splitter.reset();
+    
+    for (auto& bandCompensation : compensation)
+        for (auto& allpass : bandCompensation)
+            allpass.reset();
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::updateCrossover()
+{
+    // Every network is retuned, so whichever is picked next already has the current frequencies.
+    // The limits are those of the host rate, so the splits land in the same place at every factor.
+    const auto maximumFrequency = static_cast<SampleType>(hostSampleRate * 0.49);
+    
+    for (auto& crossover : crossovers)
+    {
+        auto lowerFrequency = SampleType(20);
+        
+        for (size_t split = 0; split < crossover.splitters.size(); ++split)
+        {
+            const auto frequency = juce::jlimit(lowerFrequency, maximumFrequency, crossoverFrequencies[split]);
+            crossover.splitters[split].setCutoffFrequency(frequency);
+            
+            for (size_t band = 0; band < crossover.compensation.size(); ++band)
+                crossover.compensation[band][split].setCutoffFrequency(frequency);
+            
+            lowerFrequency = frequency;
+        }
+    }
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::splitBands(const juce::dsp::AudioBlock<SampleType>& block, size_t numSamples) noexcept
+{
+    const auto lastSplit = static_cast<size_t>(numBands - 1);
+    auto& splitters = crossovers[activeCrossover].splitters;
+    auto& compensation = crossovers[activeCrossover].compensation;
+    
+    for (size_t channel = 0; channel < numChannels; ++channel)
+    {
+        const auto* input = block.getChannelPointer(channel);
+        std::array<SampleType*, maxBands> outputs {};
+        
+        for (size_t band = 0; band < static_cast<size_t>(numBands); ++band)
+            outputs[band] = bandBuffer.getWritePointer(static_cast<int>(band * numChannels + channel));
+        
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            auto rest = input[i];
+            
+            for (size_t split = 0; split < lastSplit; ++split)
+            {
+                SampleType low, high;
+                splitters[split].processSample(static_cast<int>(channel), rest, low, high);
+                
+                for (size_t band = 0; band < split; ++band)
+                    outputs[band][i] = compensation[band][split].processSample(static_cast<int>(channel), outputs[band][i]);
+                
+                outputs[split][i] = low;
+                rest = high;
+            }
+            
+            outputs[lastSplit][i] = rest;
+        }
+    }
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::processSingleBand(const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    jassert (maximumBlockSize > 0);
+    
+    // Oversampled blocks are longer than the host block the band was prepared for
+    for (size_t start = 0; start < block.getNumSamples(); start += maximumBlockSize)
+    {
+        auto subBlock = block.getSubBlock(start, juce::jmin(maximumBlockSize, block.getNumSamples() - start));
+        bands[0].process(juce::dsp::ProcessContextReplacing<SampleType>(subBlock));
+    }
+}
+
+template <typename SampleType>
+void MultibandDistortion<SampleType>::processBands(const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    jassert (block.getNumChannels() == numChannels);
+    
+    const auto maxSubBlock = static_cast<size_t>(bandBuffer.getNumSamples());
+    
+    for (size_t start = 0; start < block.getNumSamples(); start += maxSubBlock)
+    {
+        const auto numSamples = juce::jmin(maxSubBlock, block.getNumSamples() - start);
+        auto subBlock = block.getSubBlock(start, numSamples);
+        
+        splitBands(subBlock, numSamples);
+        
+        juce::dsp::AudioBlock<SampleType> bandBlocks { bandBuffer.getArrayOfWritePointers(), static_cast<size_t>(bandBuffer.getNumChannels()), numSamples };
+        
+        for (size_t band = 0; band < static_cast<size_t>(numBands); ++band)
+        {
+            auto bandBlock = bandBlocks.getSubsetChannelBlock(band * numChannels, numChannels);
+            bands[band].process(juce::dsp::ProcessContextReplacing<SampleType>(bandBlock));
+            
+            if (band == 0)
+                subBlock.copyFrom(bandBlock);
+            else
+                subBlock.add(bandBlock);
+        }
+    }
+}
+
+template class MultibandDistortion<float>;
+template class MultibandDistortion<double>;
@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    multiband.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "dsp.h"
+
+/** Up to four Distortion bands behind a Linkwitz-Riley crossover network.
+
+    Each split is a 4th order Linkwitz-Riley low/high pair. The bands below a split also go through
+    the matching Linkwitz-Riley allpass, so every band has the same phase response and an untouched
+    signal sums back flat. With one band the crossover is skipped and band 0 processes the block on
+    its own, exactly like a plain Distortion.
+
+    The bands are split, shaped and summed a sub-block at a time, so the band signals stay in cache
+    even at high oversampling factors. A single band runs in host-sized pieces too, so nothing is
+    sized for the oversampling factor. Everything is allocated in prepare().
+    
+    prepare() tunes one crossover network for the host rate and one for each oversampled rate, so
+    switching the oversampling factor only picks another network and never recomputes coefficients.
+*/
+template <typename SampleType>
+class MultibandDistortion
+{
+public:
+    static constexpr int maxBands = 4;
+    
+    // Oversampled rates go up to the host rate times 2^maxOversamplingStages
+    static constexpr int maxOversamplingStages = 4;
+    
+    // At the lowest crossover frequency an impulse through the network falls 120 dB within 0.2 s
+    static constexpr double tailLengthSeconds = 0.2;
+    
+    void setNumBands(int newNumBands);
+    
+    int getNumBands() const noexcept { return numBands; }
+    
+    /** Sets the split between band index and index + 1. Out of order frequencies are pushed up to the split below. */
+    void setCrossoverFrequency(int index, SampleType newFrequency);
+    
+    Distortion<SampleType>& getBand(int index) noexcept { return bands[static_cast<size_t>(index)]; }
+    
+    /** Takes the host rate and block size. The crossover networks for the oversampled rates are tuned
+        from the rate, and oversampled blocks are processed in pieces no longer than the block size. */
+    void prepare(juce::dsp::ProcessSpec& spec);
+    
+    /** Runs at the host rate times 2^stages from now on. Switches to that rate's crossover network and
+        forwards the rate to every band. Doesn't allocate, so it is safe to call from the audio thread. */
+    void setOversamplingStages(int stages);
+    
+    void setControlInterval(size_t numSamples);
+    
+    /** Forwards to every band, so the whole signal follows one envelope. Its position advances
+        with the sub-blocks, so they stay in step with the block the offsets were made for. */
+    void setDriveModulation(const SampleType* offsetDecibels, size_t numOffsets, size_t samplesPerOffset) noexcept;
+    
+    void reset();
+    
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock      = context.getOutputBlock();
+        
+        jassert (inputBlock.getNumChannels() == outputBlock.getNumChannels());
+        jassert (inputBlock.getNumSamples()  == outputBlock.getNumSamples());
+        
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(inputBlock);
+        
+        if (numBands == 1)
+            processSingleBand(outputBlock);
+        else
+            processBands(outputBlock);
+    }
+
+private:
+    void processSingleBand(const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+    
+    void processBands(const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+    
+    void splitBands(const juce::dsp::AudioBlock<SampleType>& block, size_t numSamples) noexcept;
+    
+    void updateCrossover();
+    
+    std::array<Distortion<SampleType>, maxBands> bands;
+    int numBands = 1;
+    
+    // splitters[i] divides what is left above crossover i-1 at crossover i. compensation[b][i] is the
+    // allpass at crossover i that band b < i goes through so that it lines up with the bands above it.
+    struct Crossover
+    {
+        std::array<juce::dsp::LinkwitzRileyFilter<SampleType>, maxBands - 1> splitters;
+        std::array<std::array<juce::dsp::LinkwitzRileyFilter<SampleType>, maxBands - 1>, maxBands - 2> compensation;
+        
+        void reset();
+    };
+    
+    // One per oversampling factor, tuned to the host rate times 2^index
+    std::array<Crossover, maxOversamplingStages + 1> crossovers;
+    size_t activeCrossover = 0;
+    
+    std::array<SampleType, maxBands - 1> crossoverFrequencies { 200, 1000, 5000 };
+    double hostSampleRate = 44100.0;
+    
+    // The largest block the bands were prepared for
+    size_t maximumBlockSize = 0;
+    
+    // The channels of each band one after the other, one sub-block long
+    static constexpr size_t subBlockSize = 256;
+    juce::AudioBuffer<SampleType> bandBuffer;
+    size_t numChannels = 0;
+};
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    parameters.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/** The latest value of every plugin parameter plus one dirty flag each, shared between the
+    thread that changes a parameter and the audio thread.
+
+    Writers only store the value and raise its flag. The audio thread collects all raised flags
+    with a single atomic exchange at the start of a block and applies just those parameters, so
+    nothing on the audio path is touched from another thread and an automation burst costs one
+    update per parameter per block. Neither side locks or allocates.
+*/
+template <size_t NumParameters>
+class ParameterSnapshot
+{
+public:
+    using Mask = juce::uint64;
+    
+    static_assert (NumParameters <= 64, "One dirty bit per parameter");
+    
+    static constexpr Mask allParameters = NumParameters == 64 ? ~Mask(0) : (Mask(1) << NumParameters) - 1;
+    
+    static constexpr Mask getFlag(size_t index) noexcept { return Mask(1) << index; }
+    
+    /** Stores a new value and marks it as changed. Safe to call from any thread. */
+    void publish(size_t index, float newValue) noexcept
+    {
+        jassert (index < NumParameters);
+        
+        values[index].store(newValue, std::memory_order_relaxed);
+        dirtyFlags.fetch_or(getFlag(index), std::memory_order_release);
+    }
+    
+    /** Returns the flags of every parameter published since the last call and clears them.
+        Values read with get() afterwards are at least as new as the ones that raised the flags. */
+    Mask consumeChanges() noexcept
+    {
+        return dirtyFlags.exchange(0, std::memory_order_acq_rel);
+    }
+    
+    float get(size_t index) const noexcept
+    {
+        jassert (index < NumParameters);
+        
+        return values[index].load(std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<float>, NumParameters> values {};
+    std::atomic<Mask> dirtyFlags { 0 };
+};
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    presets.cpp
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#include "presets.h"
+
+const std::vector<PresetBank::Preset>& PresetBank::getFactoryPresets()
+{
+    // MODE: 0 Full Wave, 1 Half Wave, 2 Hard, 3 Soft1, 4 Soft2, 5 Soft3, 6 Saturation, 7 Bit Reduction.
+    // OVERSAMPLING: 0 off to 4 for 16x. STEREO: 0 L/R, 1 Mid/Side, 2 Linked.
+    static const std::vector<Preset> presets
+    {
+        { "Default", {} },
+
+        { "Warm Saturation", { { "MODE", 6 }, { "GAIN", 9 }, { "MIX", 1 }, { "TONE", 12000 }, { "OUTPUT", -4 },
+                               { "OVERSAMPLING", 2 } } },
+        
+        { "Glue Bus", { { "MODE", 4 }, { "GAIN", 6 }, { "MIX", 0.7f }, { "OUTPUT", -3 }, { "STEREO", 2 },
+                        { "OVERSAMPLING", 1 }, { "ADAA", 1 } } },
+        
+        { "Hard Edge", { { "MODE", 2 }, { "GAIN", 18 }, { "MIX", 1 }, { "OUTPUT", -10 },
+                         { "OVERSAMPLING", 2 }, { "ADAA", 2 } } },
+        
+        { "Octave Fuzz", { { "MODE", 0 }, { "GAIN", 12 }, { "MIX", 0.6f }, { "TONE", 6000 }, { "OUTPUT", -6 },
+                           { "OVERSAMPLING", 1 } } },
+        
+        { "Lo-Fi Sampler", { { "MODE", 7 }, { "MIX", 1 }, { "BITS", 10 }, { "RATE", 11025 }, { "DITHER", 1 },
+                             { "TONE", 5000 } } },
+        
+        { "Wide Drive", { { "MODE", 5 }, { "GAIN", 6 }, { "MIX", 1 }, { "STEREO", 1 }, { "SIDEGAIN", 15 },
+                          { "SIDEMIX", 1 }, { "OUTPUT", -4 } } },
+        
+        { "Multiband Grit", { { "BANDS", 2 }, { "XOVER1", 250 }, { "XOVER2", 3000 },
+                              { "MODE", 3 }, { "GAIN", 3 }, { "MIX", 0.5f },
+                              { "MODE2", 5 }, { "GAIN2", 9 }, { "MIX2", 0.8f },
+                              { "MODE3", 2 }, { "GAIN3", 6 }, { "MIX3", 0.4f }, { "OUTPUT", -4 } } },
+        
+        { "Pumping Drive", { { "MODE", 6 }, { "GAIN", 3 }, { "MIX", 1 }, { "ENVDEPTH", 12 }, { "ATTACK", 5 },
+                             { "RELEASE", 200 }, { "OUTPUT", -6 } } }
+    };
+    
+    return presets;
+}
+
+void PresetBank::build(const juce::Array<juce::RangedAudioParameter*>& parametersToControl)
+{
+    parameters = parametersToControl;
+    names.clear();
+    values.clear();
+    
+    const auto& presets = getFactoryPresets();
+    values.reserve(presets.size() * static_cast<size_t>(parameters.size()));
+    
+    for (const auto& preset : presets)
+    {
+        const auto row = values.size();
+        
+        for (auto* parameter : parameters)
+            values.push_back(parameter->getDefaultValue());
+        
+        for (const auto& setting : preset.settings)
+        {
+            auto found = false;
+            
+            for (int i = 0; i < parameters.size() && ! found; ++i)
+            {
+                auto* parameter = parameters.getUnchecked(i);
+                found = parameter->paramID == setting.parameterID;
+                
+                if (found)
+                    values[row + static_cast<size_t>(i)] = parameter->convertTo0to1(setting.value);
+            }
+            
+            // A preset for a parameter that no longer exists
+            jassert (found);
+        }
+        
+        names.add(preset.name);
+    }
+}
+
+void PresetBank::apply(int index) const
+{
+    if (! juce::isPositiveAndBelow(index, names.size()))
+        return;
+    
+    const auto* row = values.data() + static_cast<size_t>(index) * static_cast<size_t>(parameters.size());
+    
+    for (int i = 0; i < parameters.size(); ++i)
+    {
+        auto* parameter = parameters.getUnchecked(i);
+        
+        parameter->beginChangeGesture();
+        parameter->setValueNotifyingHost(row[i]);
+        parameter->endChangeGesture();
+    }
+}
@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    presets.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/** The factory programs the host sees through setCurrentProgram() and getProgramName().
+
+    Each preset only lists the parameters it changes. The bank resolves them against the plugin's
+    parameters once, when it is built, into a complete set of normalised values per preset, so that
+    switching programs is a loop of setValueNotifyingHost() calls with no lookups or parsing. */
+class PresetBank
+{
+public:
+    struct Setting
+    {
+        const char* parameterID;
+        
+        /** In the parameter's own units: dB, Hz, a choice index, 0 or 1 for a switch. */
+        float value;
+    };
+    
+    struct Preset
+    {
+        const char* name;
+        std::vector<Setting> settings;
+    };
+    
+    /** The built-in presets. The first one is the plugin's defaults. */
+    static const std::vector<Preset>& getFactoryPresets();
+    
+    /** Resolves the factory presets against the given parameters. Parameters a preset doesn't
+        mention go back to their defaults when it is applied. */
+    void build(const juce::Array<juce::RangedAudioParameter*>& parametersToControl);
+    
+    int getNumPresets() const noexcept { return names.size(); }
+    
+    juce::String getName(int index) const { return names[index]; }
+    
+    /** Sets every parameter to the values of a preset, each as one gesture. This notifies the host
+        and the parameter listeners, which lock, so it belongs on the message thread. */
+    void apply(int index) const;
+
+private:
+    juce::Array<juce::RangedAudioParameter*> parameters;
+    juce::StringArray names;
+    
+    // One row of normalised values per preset, in the order of parameters
+    std::vector<float> values;
+};
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    resources.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <tuple>
+
+/** Identifies a shared resource among the others of its type. Whatever a resource doesn't depend on stays 0. */
+struct ResourceKey
+{
+    double sampleRate = 0.0;
+    int factor = 0;
+    int mode = 0;
+    int resolution = 0;
+    
+    bool operator< (const ResourceKey& other) const noexcept
+    {
+        return std::tie(sampleRate, factor, mode, resolution) < std::tie(other.sampleRate, other.factor, other.mode, other.resolution);
+    }
+};
+
+/** Immutable resources that every plugin instance in the process shares: lookup tables, FFT plans and the like.
+    
+    The first instance to ask for a key builds the resource and later ones get the same object. The cache only
+    holds it weakly, so it is freed once the last instance holding it lets go, and built again if another asks
+    after that. Lookups lock, so they belong in prepareToPlay or on another non-realtime thread; the audio thread
+    only uses the pointers it was handed there. */
+template <typename Resource>
+class SharedResourceCache
+{
+public:
+    static SharedResourceCache& getInstance()
+    {
+        static SharedResourceCache cache;
+        return cache;
+    }
+    
+    /** Returns the resource for a key, calling create() for a new one if nobody holds it. create() runs under
+        the lock, so instances preparing at the same time build each resource only once. */
+    template <typename Factory>
+    std::shared_ptr<const Resource> get(const ResourceKey& key, Factory&& create)
+    {
+        const juce::ScopedLock scope (lock);
+        
+        if (auto existing = entries[key].lock())
+            return existing;
+        
+        // Forgets the keys nobody holds any more, so the map doesn't keep every sample rate ever seen
+        for (auto entry = entries.begin(); entry != entries.end();)
+            entry = entry->second.expired() ? entries.erase(entry) : std::next(entry);
+        
+        std::shared_ptr<const Resource> resource = create();
+        entries[key] = resource;
+        return resource;
+    }
+    
+    /** How many resources of this type are alive. */
+    int getNumResources() const
+    {
+        const juce::ScopedLock scope (lock);
+        
+        return static_cast<int>(std::count_if(entries.begin(), entries.end(), [] (const auto& entry) { return ! entry.second.expired(); }));
+    }
+
+private:
+    SharedResourceCache() = default;
+    
+    juce::CriticalSection lock;
+    std::map<ResourceKey, std::weak_ptr<const Resource>> entries;
+    
+    JUCE_DECLARE_NON_COPYABLE (SharedResourceCache)
+};
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    tables.cpp
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#include "tables.h"
+
+namespace
+{
+    constexpr double piDivisor = 2.0 / juce::MathConstants<double>::pi;
+    
+    // The curves match the waveshaping part of the scalar reference functions in dsp.cpp
+    double softClipping1(double x)
+    {
+        const auto magnitude = std::abs(x);
+        
+        if (magnitude < 0.33)
+            return 2.0 * x;
+        
+        if (magnitude < 0.67)
+            return (3.0 - std::pow(2.0 - 3.0 * x, 2.0)) / 3.0;
+        
+        return 1.0;
+    }
+    
+    double softClipping2(double x)   { return piDivisor * std::atan(x); }
+    double softClipping3(double x)   { return piDivisor * std::tanh(x); }
+    
+    double saturation(double x)
+    {
+        if (x >= 0.0)
+            return std::tanh(x);
+        
+        return std::tanh(std::sinh(x)) - 0.2 * x * std::sin(juce::MathConstants<double>::pi * x);
+    }
+    
+    double one(double)               { return 1.0; }
+    double plusPiDivisor(double)     { return piDivisor; }
+    double minusPiDivisor(double)    { return -piDivisor; }
+    
+    // atan(x) = sign(x) pi/2 - 1/x + 1/(3x^3) - ..., under 1e-7 from the true curve beyond |x| = 16
+    double arctangentAsymptote(double x)
+    {
+        const auto inverse = 1.0 / x;
+        return piDivisor * ((x < 0 ? -0.5 : 0.5) * juce::MathConstants<double>::pi - inverse + inverse * inverse * inverse / 3.0);
+    }
+    
+    // tanh(sinh(x)) is exactly -1 in double precision well before -8, leaving only the sine term
+    double saturationLowerAsymptote(double x)
+    {
+        return -1.0 - 0.2 * x * std::sin(juce::MathConstants<double>::pi * x);
+    }
+}
+
+WaveshaperTable::WaveshaperTable(Function curve, Function lowerAsymptote, Function upperAsymptote, double tableRange, int resolution)
+    : lower(lowerAsymptote), upper(upperAsymptote), range(tableRange), pointsPerUnit(resolution / (2.0 * tableRange))
+{
+    jassert (resolution > 0 && tableRange > 0.0);
+    
+    values.resize(static_cast<size_t>(resolution) + 3);
+    
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = curve(-range + (static_cast<double>(i) - 1.0) / pointsPerUnit);
+}
+
+std::shared_ptr<const WaveshaperTable> WaveshaperTable::getShared(Curve curve)
+{
+    struct Design
+    {
+        Function curve, lower, upper;
+        double range;
+        int resolution;
+    };
+    
+    // The sinh and tanh tails are already at their asymptotes by +-8, atan needs a wider range
+    static constexpr std::array<Design, 4> designs
+    {{
+        { softClipping1, one,                      one,                 1.0,  4096 },
+        { softClipping2, arctangentAsymptote,      arctangentAsymptote, 16.0, 8192 },
+        { softClipping3, minusPiDivisor,           plusPiDivisor,       8.0,  4096 },
+        { saturation,    saturationLowerAsymptote, one,                 8.0,  4096 }
+    }};
+    
+    const auto& design = designs[static_cast<size_t>(curve)];
+    
+    ResourceKey key;
+    key.mode = static_cast<int>(curve);
+    key.resolution = design.resolution;
+    
+    return SharedResourceCache<WaveshaperTable>::getInstance().get(key, [&design]
+    {
+        return std::make_shared<const WaveshaperTable>(design.curve, design.lower, design.upper, design.range, design.resolution);
+    });
+}
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    tables.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "resources.h"
+
+/** A waveshaping curve sampled once on [-range, range] and read back with linear or cubic
+    (Catmull-Rom) interpolation. Inputs outside the range go to the curve's analytic asymptotes.
+ 
+    The tables for the distortion modes are shared read-only by every instance in the process
+    through SharedResourceCache, so they cost one set of memory and one build no matter how many
+    plugins are loaded, and are freed with the last instance that uses them.
+*/
+class WaveshaperTable
+{
+public:
+    using Function = double (*)(double);
+    
+    enum class Curve
+    {
+        kSoft1,
+        kSoft2,
+        kSoft3,
+        kSaturation
+    };
+    
+    WaveshaperTable(Function curve, Function lowerAsymptote, Function upperAsymptote, double range, int resolution);
+    
+    /** Returns the shared table for one of the distortion curves, building it if no instance holds it.
+        Thread-safe, but it locks: call it while preparing, not from the audio thread. */
+    static std::shared_ptr<const WaveshaperTable> getShared(Curve curve);
+    
+    template <typename SampleType>
+    SampleType processLinear(SampleType x) const noexcept
+    {
+        if (! isInRange(x))
+            return processAsymptote(x);
+        
+        const auto position = (static_cast<double>(x) + range) * pointsPerUnit;
+        const auto index = getIndex(position);
+        const auto t = position - static_cast<double>(index);
+        const auto* p = values.data() + index + 1;
+        
+        return static_cast<SampleType>(p[0] + t * (p[1] - p[0]));
+    }
+    
+    template <typename SampleType>
+    SampleType processCubic(SampleType x) const noexcept
+    {
+        if (! isInRange(x))
+            return processAsymptote(x);
+        
+        const auto position = (static_cast<double>(x) + range) * pointsPerUnit;
+        const auto index = getIndex(position);
+        const auto t = position - static_cast<double>(index);
+        const auto* p = values.data() + index;
+        
+        const auto c1 = 0.5 * (p[2] - p[0]);
+        const auto c2 = p[0] - 2.5 * p[1] + 2.0 * p[2] - 0.5 * p[3];
+        const auto c3 = 0.5 * (p[3] - p[0]) + 1.5 * (p[1] - p[2]);
+        
+        return static_cast<SampleType>(p[1] + t * (c1 + t * (c2 + t * c3)));
+    }
+    
+    double getRange() const noexcept { return range; }
+    
+    size_t getMemoryUsage() const noexcept { return values.size() * sizeof(double); }
+
+private:
+    // Written so that NaN fails it too and takes the asymptote path instead of indexing the table
+    template <typename SampleType>
+    bool isInRange(SampleType x) const noexcept
+    {
+        return x > -range && x < range;
+    }
+    
+    // An input just below range can round to the last point, which would take the cubic past the guard
+    size_t getIndex(double position) const noexcept
+    {
+        return juce::jmin(static_cast<size_t>(position), values.size() - 4);
+    }
+    
+    template <typename SampleType>
+    SampleType processAsymptote(SampleType x) const noexcept
+    {
+        return static_cast<SampleType>(x < 0 ? lower(x) : upper(x));
+    }
+    
+    Function lower, upper;
+    double range, pointsPerUnit;
+    
+    // One guard point either side of [-range, range] for the cubic interpolation
+    std::vector<double> values;
+};
@@ -0,0 +1,240 @@
+/*
+  ==============================================================================
+
+    tonefilter.cpp
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#include "tonefilter.h"
+
+namespace
+{
+    template <typename SampleType>
+    using SIMDType = juce::dsp::SIMDRegister<SampleType>;
+
+    // The scratch and state buffers come from HeapBlock, which doesn't promise SIMD alignment
+    template <typename SampleType>
+    inline SIMDType<SampleType> loadUnaligned(const SampleType* source) noexcept
+    {
+        SIMDType<SampleType> result;
+        std::memcpy(&result.value, source, sizeof(result.value));
+        return result;
+    }
+    
+    template <typename SampleType>
+    inline void storeUnaligned(SampleType* destination, SIMDType<SampleType> source) noexcept
+    {
+        std::memcpy(destination, &source.value, sizeof(source.value));
+    }
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::setCutoffFrequency(SampleType newCutoff)
+{
+    cutoff.setTargetValue(juce::jmax(newCutoff, minimumFrequency));
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::setControlInterval(size_t numSamples)
+{
+    jassert (numSamples > 0);
+    controlInterval = numSamples;
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    sampleRate = spec.sampleRate;
+    
+    numGroups = (spec.numChannels + numLanes - 1) / numLanes;
+    states.allocate(numGroups * kNumStates * numLanes, true);
+    interleaved.allocate(spec.maximumBlockSize * numLanes, true);
+    
+    // Enough entries for the smallest control interval setControlInterval accepts
+    coefficients.allocate(spec.maximumBlockSize, true);
+    
+    dryBuffer.setSize(static_cast<int>(spec.numChannels), static_cast<int>(spec.maximumBlockSize));
+    
+    reset();
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::reset()
+{
+    cutoff.reset(sampleRate, 0.05);
+    wet.reset(sampleRate, bypassFadeSeconds);
+    wet.setCurrentAndTargetValue(0);
+    isActive = false;
+    
+    for (size_t i = 0; i < numGroups * kNumStates * numLanes; ++i)
+        states[i] = 0;
+}
+
+template <typename SampleType>
+typename ToneFilter<SampleType>::Coefficients ToneFilter<SampleType>::getCoefficients(SampleType frequency) const noexcept
+{
+    // Keep tan() well away from its pole at Nyquist
+    frequency = juce::jmin(frequency, static_cast<SampleType>(sampleRate * 0.49));
+    
+    const auto g = std::tan(juce::MathConstants<SampleType>::pi * frequency / static_cast<SampleType>(sampleRate));
+    const auto k = juce::MathConstants<SampleType>::sqrt2;
+    
+    Coefficients result;
+    result.a1 = 1 / (1 + g * (g + k));
+    result.a2 = g * result.a1;
+    result.a3 = g * result.a2;
+    return result;
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::updateCoefficients(size_t numSamples) noexcept
+{
+    if (! cutoff.isSmoothing())
+    {
+        coefficients[0] = getCoefficients(cutoff.getTargetValue());
+        return;
+    }
+    
+    for (size_t start = 0, interval = 0; start < numSamples; start += controlInterval, ++interval)
+    {
+        const auto length = juce::jmin(controlInterval, numSamples - start);
+        coefficients[interval] = getCoefficients(cutoff.skip(static_cast<int>(length)));
+    }
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::primeStates(const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    // A low-pass settled on a constant input has an empty band-pass integrator and the input in the
+    // low-pass one, for both stages. Starting from there avoids a step when the filter engages.
+    for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+    {
+        auto* groupStates = states.get() + (channel / numLanes) * kNumStates * numLanes;
+        const auto lane = channel % numLanes;
+        const auto input = block.getNumSamples() > 0 ? block.getChannelPointer(channel)[0] : SampleType(0);
+        
+        groupStates[kFirstIntegrator1 * numLanes + lane] = 0;
+        groupStates[kFirstIntegrator2 * numLanes + lane] = input;
+        groupStates[kSecondIntegrator1 * numLanes + lane] = 0;
+        groupStates[kSecondIntegrator2 * numLanes + lane] = input;
+    }
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::processBlock(const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    const auto numChannels = block.getNumChannels();
+    const auto numSamples  = block.getNumSamples();
+    
+    jassert (numChannels <= numGroups * numLanes);
+    
+    if (! isActive)
+    {
+        primeStates(block);
+        isActive = true;
+    }
+    
+    const auto isRamping = cutoff.isSmoothing();
+    updateCoefficients(numSamples);
+    
+    for (size_t group = 0; group * numLanes < numChannels; ++group)
+    {
+        const auto firstChannel = group * numLanes;
+        const auto groupChannels = juce::jmin(numLanes, numChannels - firstChannel);
+        auto* groupStates = states.get() + group * kNumStates * numLanes;
+        
+        // Lanes past the last channel are filtered as silence and never written back
+        for (size_t lane = 0; lane < numLanes; ++lane)
+        {
+            if (lane < groupChannels)
+            {
+                const auto* samples = block.getChannelPointer(firstChannel + lane);
+                
+                for (size_t i = 0; i < numSamples; ++i)
+                    interleaved[i * numLanes + lane] = samples[i];
+            }
+            else
+            {
+                for (size_t i = 0; i < numSamples; ++i)
+                    interleaved[i * numLanes + lane] = 0;
+            }
+        }
+        
+        auto ic1 = loadUnaligned(groupStates + kFirstIntegrator1 * numLanes);
+        auto ic2 = loadUnaligned(groupStates + kFirstIntegrator2 * numLanes);
+        auto ic3 = loadUnaligned(groupStates + kSecondIntegrator1 * numLanes);
+        auto ic4 = loadUnaligned(groupStates + kSecondIntegrator2 * numLanes);
+        
+        for (size_t start = 0, interval = 0; start < numSamples; start += controlInterval, ++interval)
+        {
+            const auto& c = coefficients[isRamping ? interval : 0];
+            const auto a1 = SIMDType::expand(c.a1);
+            const auto a2 = SIMDType::expand(c.a2);
+            const auto a3 = SIMDType::expand(c.a3);
+            const auto end = juce::jmin(start + controlInterval, numSamples);
+            
+            for (size_t i = start; i < end; ++i)
+            {
+                auto* frame = interleaved.get() + i * numLanes;
+                const auto x = loadUnaligned(frame);
+                
+                auto v3 = x - ic2;
+                auto v1 = a1 * ic1 + a2 * v3;
+                auto v2 = ic2 + a2 * ic1 + a3 * v3;
+                ic1 = v1 + v1 - ic1;
+                ic2 = v2 + v2 - ic2;
+                
+                v3 = v2 - ic4;
+                v1 = a1 * ic3 + a2 * v3;
+                v2 = ic4 + a2 * ic3 + a3 * v3;
+                ic3 = v1 + v1 - ic3;
+                ic4 = v2 + v2 - ic4;
+                
+                storeUnaligned(frame, v2);
+            }
+        }
+        
+        storeUnaligned(groupStates + kFirstIntegrator1 * numLanes, ic1);
+        storeUnaligned(groupStates + kFirstIntegrator2 * numLanes, ic2);
+        storeUnaligned(groupStates + kSecondIntegrator1 * numLanes, ic3);
+        storeUnaligned(groupStates + kSecondIntegrator2 * numLanes, ic4);
+        
+        for (size_t lane = 0; lane < groupChannels; ++lane)
+        {
+            auto* samples = block.getChannelPointer(firstChannel + lane);
+            
+            for (size_t i = 0; i < numSamples; ++i)
+                samples[i] = interleaved[i * numLanes + lane];
+        }
+    }
+}
+
+template <typename SampleType>
+void ToneFilter<SampleType>::processFade(const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    const auto numChannels = juce::jmin(block.getNumChannels(), static_cast<size_t>(dryBuffer.getNumChannels()));
+    const auto numSamples  = block.getNumSamples();
+    
+    for (size_t channel = 0; channel < numChannels; ++channel)
+        dryBuffer.copyFrom(static_cast<int>(channel), 0, block.getChannelPointer(channel), static_cast<int>(numSamples));
+    
+    processBlock(block);
+    
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        const auto gain = wet.getNextValue();
+        
+        for (size_t channel = 0; channel < numChannels; ++channel)
+        {
+            const auto dry = dryBuffer.getSample(static_cast<int>(channel), static_cast<int>(i));
+            auto& sample = block.getChannelPointer(channel)[i];
+            sample = dry + gain * (sample - dry);
+        }
+    }
+}
+
+template class ToneFilter<float>;
+template class ToneFilter<double>;
@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    tonefilter.h
+    Created: 17 Oct 2026 10:12:04am
+    Author:  Ryan
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/** The TONE low-pass: two cascaded Butterworth state variable filters in TPT form (24 dB/oct, the
+    same response as the Linkwitz-Riley low-pass it replaces).
+
+    The cutoff is smoothed and the coefficients are recomputed once per control interval rather than
+    per sample. Channels are packed into SIMD lanes and filtered together. While the cutoff sits at
+    bypassFrequency or above the stage does no work at all. Even there the filter still colours the top
+    octave, so on the way into bypass its output is crossfaded to the dry signal over bypassFadeSeconds.
+    On the way out its state is primed from the input, so engaging the filter doesn't click either.
+*/
+template <typename SampleType>
+class ToneFilter
+{
+public:
+    static constexpr SampleType bypassFrequency = 20000;
+    static constexpr SampleType minimumFrequency = 20;
+    static constexpr double bypassFadeSeconds = 0.01;
+    
+    // The longest the filter rings for: at minimumFrequency an impulse falls 120 dB below its peak within 0.19 s
+    static constexpr double tailLengthSeconds = 0.2;
+    
+    void setCutoffFrequency(SampleType newCutoff);
+    
+    /** Sets how many samples share one set of coefficients while the cutoff is ramping. */
+    void setControlInterval(size_t numSamples);
+    
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    
+    void reset();
+    
+    /** True once the cutoff has settled at bypassFrequency or above. The output fades to the dry
+        signal from then on and is untouched once the fade is over. */
+    bool isBypassed() const noexcept { return ! cutoff.isSmoothing() && cutoff.getTargetValue() >= bypassFrequency; }
+    
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        const auto& inputBlock = context.getInputBlock();
+        auto& outputBlock      = context.getOutputBlock();
+        
+        jassert (inputBlock.getNumChannels() == outputBlock.getNumChannels());
+        jassert (inputBlock.getNumSamples()  == outputBlock.getNumSamples());
+        
+        if (context.usesSeparateInputAndOutputBlocks())
+            outputBlock.copyFrom(inputBlock);
+        
+        if (context.isBypassed)
+        {
+            isActive = false;
+            return;
+        }
+        
+        // Engaging primes the state, so only the way into bypass needs the crossfade
+        if (! isActive)
+        {
+            if (isBypassed())
+                return;
+            
+            wet.setCurrentAndTargetValue(1);
+        }
+        
+        wet.setTargetValue(isBypassed() ? 0 : 1);
+        
+        if (wet.isSmoothing())
+            processFade(outputBlock);
+        else
+            processBlock(outputBlock);
+        
+        if (wet.getTargetValue() == 0 && ! wet.isSmoothing())
+            isActive = false;
+    }
+
+private:
+    using SIMDType = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr size_t numLanes = SIMDType::SIMDNumElements;
+    
+    struct Coefficients
+    {
+        SampleType a1, a2, a3;
+    };
+    
+    void processBlock(const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+    
+    /** Filters the block and mixes it with the dry signal by the ramping wet level. */
+    void processFade(const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+    
+    void updateCoefficients(size_t numSamples) noexcept;
+    
+    Coefficients getCoefficients(SampleType frequency) const noexcept;
+    
+    void primeStates(const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+    
+    juce::SmoothedValue<SampleType, juce::ValueSmoothingTypes::Multiplicative> cutoff { bypassFrequency };
+    
+    // 1 while filtering, ramping to 0 on the way into bypass; the dry signal is kept meanwhile
+    juce::SmoothedValue<SampleType> wet { 0 };
+    juce::AudioBuffer<SampleType> dryBuffer;
+    
+    double sampleRate = 44100.0;
+    size_t controlInterval = 16;
+    bool isActive = false;
+    
+    // One entry per control interval of the current block
+    juce::HeapBlock<Coefficients> coefficients;
+    
+    // Up to numLanes channels interleaved sample by sample, so one register holds one sample of each
+    juce::HeapBlock<SampleType> interleaved;
+    
+    // The two integrator states of both stages for each group of numLanes channels, lane by lane
+    enum StateIndex
+    {
+        kFirstIntegrator1,
+        kFirstIntegrator2,
+        kSecondIntegrator1,
+        kSecondIntegrator2,
+        kNumStates
+    };
+    
+    juce::HeapBlock<SampleType> states;
+    size_t numGroups = 0;
+};